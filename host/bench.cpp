@@ -0,0 +1,136 @@
+// Frame-stepping benchmark for the simulation core.
+// Runs every scenario for a fixed number of frames and reports time and physics work per frame.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "physics.h"
+#include "entities.h"
+#include "rewind.h"
+#include "scenarios.h"
+
+namespace
+{
+
+struct run_result
+{
+    double ns_per_frame;
+    physics_stats stats;
+    fixed player_x;
+    fixed player_y;
+    int clones;
+};
+
+run_result run(const scenario &s, int frames)
+{
+    world game(s.level);
+    auto &pm = physics_manager::instance();
+    pm.stats = physics_stats();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        game.update(scripted_input(s, frame));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    run_result result;
+    result.ns_per_frame = std::chrono::duration<double, std::nano>(end - start).count() / frames;
+    result.stats = pm.stats;
+    result.player_x = pm.entities.x[PLAYER_ID];
+    result.player_y = pm.entities.y[PLAYER_ID];
+    result.clones = game.clones.size();
+    return result;
+}
+
+// Frames stepped back at the end of the rewind check
+constexpr int REWIND_CHECK_FRAMES = 60;
+
+struct rewind_result
+{
+    double bytes_per_frame; // average history cost while the buffer still holds every frame
+    bool exact;             // stepping back landed on the state saved at that frame
+};
+
+// Untimed: records every frame, then steps back and compares against a snapshot taken on the way
+rewind_result check_rewind(const scenario &s, int frames)
+{
+    static uint8_t expected[world::state_size()];
+    static uint8_t restored[world::state_size()];
+
+    world game(s.level);
+    rewind_buffer history;
+    history.reset(game, 0, 0);
+
+    rewind_result result = {0, false};
+    int snapshot_frame = frames - REWIND_CHECK_FRAMES;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        if (frame == snapshot_frame)
+            game.save_state(expected);
+
+        game.update(scripted_input(s, frame));
+        history.record(game, 0, 0);
+
+        if (history.frames() == frame + 1)
+            result.bytes_per_frame = double(history.used_bytes()) / history.frames();
+    }
+
+    fixed camera_x, camera_y;
+    for (int frame = 0; frame < REWIND_CHECK_FRAMES; ++frame)
+    {
+        if (!history.step_back(game, camera_x, camera_y))
+            return result;
+    }
+
+    game.save_state(restored);
+    result.exact = std::memcmp(expected, restored, sizeof(expected)) == 0;
+    return result;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 3600;
+    int passes = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    if (frames <= REWIND_CHECK_FRAMES || passes <= 0)
+    {
+        std::fprintf(stderr, "usage: %s [frames] [passes]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%-14s %10s %12s %12s %12s %20s %6s %12s\n",
+                "scenario", "ns/frame", "tiles/frame", "pairs/frame", "pushes/frame", "final player", "clones",
+                "rewind B/f");
+
+    bool rewind_exact = true;
+
+    for (const scenario &s : scenarios)
+    {
+        // Work counters are identical across passes, keep the fastest timing
+        run_result best = run(s, frames);
+        for (int pass = 1; pass < passes; ++pass)
+        {
+            run_result result = run(s, frames);
+            if (result.ns_per_frame < best.ns_per_frame)
+                best.ns_per_frame = result.ns_per_frame;
+        }
+
+        rewind_result rewind = check_rewind(s, frames);
+        rewind_exact = rewind_exact && rewind.exact;
+
+        std::printf("%-14s %10.1f %12.2f %12.2f %12.3f %9.3f,%9.3f %6d %12.1f%s\n", s.name, best.ns_per_frame,
+                    double(best.stats.level_queries) / frames,
+                    double(best.stats.entity_queries) / frames,
+                    double(best.stats.push_resolutions) / frames,
+                    double(best.player_x.data()) / fixed::scale(),
+                    double(best.player_y.data()) / fixed::scale(),
+                    best.clones, rewind.bytes_per_frame, rewind.exact ? "" : " MISMATCH");
+    }
+
+    return rewind_exact ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+// Microbenchmark for level collision queries.
+// Compares the lookups physics runs on the packed collision layer, tile_attributes() and the swept sweep_x/sweep_y
+// probes, against the int-per-tile, divide-based lookup they replaced and the five point box test built on it,
+// from demo01's size up to levels far past the old 512 tile cap.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "physics.h"
+
+namespace
+{
+
+constexpr int sample_count = 16384;
+
+struct level_size
+{
+    int width;
+    int height;
+};
+
+// demo01, then roughly 10x, 20x and 250x its area
+constexpr level_size level_sizes[] = {{21, 21}, {84, 56}, {168, 56}, {512, 220}};
+
+// Deterministic pseudo random numbers so every run measures the same queries
+unsigned next_random(unsigned &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+// The level layout the packed collision layer replaced, reached through a global pointer just like the old globals->level
+struct legacy_level
+{
+    const int *collisions;
+    int size_x;
+    int size_y;
+};
+
+const legacy_level *legacy_active = nullptr;
+
+// The lookup tile_attributes() replaced: one int per tile, bounds check and two divides per sample
+bool legacy_resolve(fixed x, fixed y)
+{
+    int tile_x = x.integer() / TILE_SIZE;
+    int tile_y = y.integer() / TILE_SIZE;
+
+    if (tile_x < 0 || tile_x >= legacy_active->size_x ||
+        tile_y < 0 || tile_y >= legacy_active->size_y)
+        return true;
+
+    int index = tile_y * legacy_active->size_x + tile_x;
+    return legacy_active->collisions[index] > 0;
+}
+
+// The old move test: five points of the box at the target, every frame and axis
+bool legacy_box_blocked(fixed x, fixed y)
+{
+    entity_bounds box(x, y);
+    return legacy_resolve(box.left, box.top) || legacy_resolve(box.right, box.top) ||
+           legacy_resolve(box.left, box.bottom) || legacy_resolve(box.right, box.bottom) ||
+           legacy_resolve(x, box.bottom);
+}
+
+bool packed_solid(fixed x, fixed y)
+{
+    return tile_attributes(to_tile(x), to_tile(y)) & TILE_SOLID;
+}
+
+// One frame's move of an entity in free space, as the old test and as the sweeps physics runs now
+struct move_sample
+{
+    fixed x, y, dx, dy;
+};
+
+int legacy_move(const move_sample &move)
+{
+    return legacy_box_blocked(move.x + move.dx, move.y) + legacy_box_blocked(move.x, move.y + move.dy);
+}
+
+int swept_move(const move_sample &move)
+{
+    entity_bounds box(move.x, move.y);
+    return (sweep_x(box, move.dx, TILE_SOLID) != move.dx) + (sweep_y(box, move.dy, TILE_SOLID) != move.dy);
+}
+
+template<typename Sample, typename Query>
+double time_queries(const std::vector<Sample> &samples, int passes, int &hits, Query query)
+{
+    hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        for (const Sample &sample : samples)
+        {
+            hits += query(sample);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double(passes) * samples.size());
+}
+
+struct point_sample
+{
+    fixed x, y;
+};
+
+}
+
+int main(int argc, char *argv[])
+{
+    int passes = argc > 1 ? std::atoi(argv[1]) : 500;
+
+    if (passes <= 0)
+    {
+        std::fprintf(stderr, "usage: %s [passes]\n", argv[0]);
+        return 1;
+    }
+
+    std::printf("%-10s %8s %13s %13s %13s %13s %11s %12s\n", "level", "tiles", "int ns/point", "attr ns/point",
+                "int ns/move", "swept ns/move", "int bytes", "packed bytes");
+
+    for (level_size size : level_sizes)
+    {
+        unsigned state = 12345;
+
+        // Same random terrain in both layouts: roughly a quarter of the tiles solid, values 1-4
+        int stride_shift = 1;
+        while ((1 << stride_shift) < size.width)
+            ++stride_shift;
+
+        std::vector<int> legacy(size.width * size.height);
+        std::vector<uint8_t> packed(((1 << stride_shift) * size.height) / 2);
+        for (int y = 0; y < size.height; ++y)
+        {
+            for (int x = 0; x < size.width; ++x)
+            {
+                int value = next_random(state) % 4 == 0 ? 1 + next_random(state) % 4 : 0;
+                int index = (y << stride_shift) | x;
+                legacy[y * size.width + x] = value;
+                packed[index >> 1] |= value << ((index & 1) * COLLISION_BITS);
+            }
+        }
+
+        legacy_level old_level = {legacy.data(), size.width, size.height};
+        legacy_active = &old_level;
+
+        level_ptr level = {nullptr, packed.data(), stride_shift, size.width, size.height, 0, 0, 256};
+        physics_manager::instance().level = &level;
+
+        // Sample points inside the map, with fractional pixels like real entity edges
+        auto random_position = [&](int pixels) {
+            return fixed::from_data(int(next_random(state) % unsigned(pixels << fixed::precision())));
+        };
+        auto random_x = [&] { return random_position(to_pixel(size.width)); };
+        auto random_y = [&] { return random_position(to_pixel(size.height)); };
+        std::vector<point_sample> points(sample_count);
+        for (point_sample &point : points)
+        {
+            point = {random_x(), random_y()};
+            if (legacy_resolve(point.x, point.y) != packed_solid(point.x, point.y))
+            {
+                std::fprintf(stderr, "mismatch at (%d, %d)\n", point.x.integer(), point.y.integer());
+                return 1;
+            }
+        }
+
+        // Moves of up to a dash a frame each way, from boxes that start clear of the level like real entities and
+        // at least a box away from the map edges, where the old lookup's divides rounded toward zero.
+        // Moving less than a tile from a clear spot, the sweeps stop short exactly when the old test was blocked.
+        std::vector<move_sample> moves;
+        while (int(moves.size()) < sample_count)
+        {
+            move_sample move = {random_position(to_pixel(size.width) - 2 * ENTITY_SIZE) + ENTITY_SIZE,
+                                random_position(to_pixel(size.height) - 2 * ENTITY_SIZE) + ENTITY_SIZE,
+                                fixed::from_data(int(next_random(state) % 12289) - 6144) * 4,
+                                fixed::from_data(int(next_random(state) % 12289) - 6144) * 4};
+            if (legacy_box_blocked(move.x, move.y))
+                continue;
+
+            if (legacy_move(move) != swept_move(move))
+            {
+                std::fprintf(stderr, "move mismatch at (%d, %d)\n", move.x.integer(), move.y.integer());
+                return 1;
+            }
+            moves.push_back(move);
+        }
+
+        int legacy_hits, packed_hits, legacy_blocks, swept_blocks;
+        double legacy_ns = time_queries(points, passes, legacy_hits, [](const point_sample &point) {
+            return legacy_resolve(point.x, point.y);
+        });
+        double packed_ns = time_queries(points, passes, packed_hits, [](const point_sample &point) {
+            return packed_solid(point.x, point.y);
+        });
+        double legacy_move_ns = time_queries(moves, passes, legacy_blocks, legacy_move);
+        double swept_move_ns = time_queries(moves, passes, swept_blocks, swept_move);
+
+        if (legacy_hits != packed_hits || legacy_blocks != swept_blocks)
+        {
+            std::fprintf(stderr, "hit count mismatch: %d vs %d, %d vs %d\n", legacy_hits, packed_hits, legacy_blocks,
+                         swept_blocks);
+            return 1;
+        }
+
+        char name[16];
+        std::snprintf(name, sizeof(name), "%dx%d", size.width, size.height);
+        std::printf("%-10s %8d %13.2f %13.2f %13.2f %13.2f %11zu %12zu\n", name, size.width * size.height, legacy_ns,
+                    packed_ns, legacy_move_ns, swept_move_ns, legacy.size() * sizeof(int), packed.size());
+    }
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// Host stand-in for Butano's bn_algorithm.h.
+
+#include <algorithm>
+
+namespace bn
+{
+    using std::find;
+    using std::find_if;
+    using std::fill;
+    using std::copy;
+    using std::min;
+    using std::max;
+    using std::sort;
+}
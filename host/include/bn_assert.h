@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for Butano's bn_assert.h: messages are dropped, the condition still aborts.
+
+#include <cassert>
+#include <cstdlib>
+
+#define BN_ASSERT(condition, ...) assert(condition)
+#define BN_ERROR(...) std::abort()
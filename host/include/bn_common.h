@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for Butano's bn_common.h, memory placement attributes are no-ops off the GBA.
+
+#include <cstdint>
+
+#define BN_CODE_IWRAM
+#define BN_CODE_EWRAM
+#define BN_DATA_EWRAM
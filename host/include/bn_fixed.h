@@ -0,0 +1,111 @@
+#pragma once
+
+// Host stand-in for Butano's bn_fixed.h.
+// Same storage, conversions and operators as the GBA build so the simulation steps identically.
+
+#include <cstdint>
+
+namespace bn
+{
+
+template<int Precision>
+class fixed_t
+{
+    static_assert(Precision > 0 && Precision < 31);
+
+public:
+    [[nodiscard]] static constexpr int precision() { return Precision; }
+    [[nodiscard]] static constexpr int scale() { return 1 << Precision; }
+
+    [[nodiscard]] static constexpr fixed_t from_data(int data)
+    {
+        fixed_t result;
+        result._data = data;
+        return result;
+    }
+
+    constexpr fixed_t() = default;
+    constexpr fixed_t(int value) : _data(value * scale()) {}
+    constexpr fixed_t(float value) : _data(int(value * scale())) {}
+    constexpr fixed_t(double value) : _data(int(value * scale())) {}
+
+    template<int OtherPrecision>
+    constexpr fixed_t(fixed_t<OtherPrecision> other) :
+        _data(Precision < OtherPrecision ?
+                  other.data() >> (OtherPrecision - Precision) :
+                  other.data() * (1 << (Precision - OtherPrecision)))
+    {
+    }
+
+    [[nodiscard]] constexpr int data() const { return _data; }
+    [[nodiscard]] constexpr int integer() const { return _data / scale(); }
+    [[nodiscard]] constexpr int right_shift_integer() const { return _data >> Precision; }
+    [[nodiscard]] constexpr int floor_integer() const { return _data >> Precision; }
+    [[nodiscard]] constexpr int ceil_integer() const { return (_data + scale() - 1) >> Precision; }
+    [[nodiscard]] constexpr int round_integer() const { return (_data + scale() / 2) >> Precision; }
+    [[nodiscard]] constexpr fixed_t fraction() const { return from_data(_data & (scale() - 1)); }
+
+    [[nodiscard]] constexpr fixed_t multiplication(fixed_t other) const
+    {
+        return from_data(int((int64_t(_data) * other._data) >> Precision));
+    }
+
+    [[nodiscard]] constexpr fixed_t division(fixed_t other) const
+    {
+        return from_data(int((int64_t(_data) * scale()) / other._data));
+    }
+
+    constexpr fixed_t operator-() const { return from_data(-_data); }
+    constexpr fixed_t operator+() const { return *this; }
+
+    constexpr fixed_t &operator+=(fixed_t other) { _data += other._data; return *this; }
+    constexpr fixed_t &operator-=(fixed_t other) { _data -= other._data; return *this; }
+    constexpr fixed_t &operator*=(int value) { _data *= value; return *this; }
+    constexpr fixed_t &operator*=(fixed_t other) { *this = multiplication(other); return *this; }
+    constexpr fixed_t &operator/=(int value) { _data /= value; return *this; }
+    constexpr fixed_t &operator/=(fixed_t other) { *this = division(other); return *this; }
+
+    [[nodiscard]] constexpr friend fixed_t operator+(fixed_t a, fixed_t b) { return from_data(a._data + b._data); }
+    [[nodiscard]] constexpr friend fixed_t operator-(fixed_t a, fixed_t b) { return from_data(a._data - b._data); }
+    [[nodiscard]] constexpr friend fixed_t operator*(fixed_t a, fixed_t b) { return a.multiplication(b); }
+    [[nodiscard]] constexpr friend fixed_t operator*(fixed_t a, int b) { return from_data(a._data * b); }
+    [[nodiscard]] constexpr friend fixed_t operator*(int a, fixed_t b) { return from_data(a * b._data); }
+    [[nodiscard]] constexpr friend fixed_t operator/(fixed_t a, fixed_t b) { return a.division(b); }
+    [[nodiscard]] constexpr friend fixed_t operator/(fixed_t a, int b) { return from_data(a._data / b); }
+
+    [[nodiscard]] constexpr friend bool operator==(fixed_t a, fixed_t b) { return a._data == b._data; }
+    [[nodiscard]] constexpr friend bool operator!=(fixed_t a, fixed_t b) { return a._data != b._data; }
+    [[nodiscard]] constexpr friend bool operator<(fixed_t a, fixed_t b) { return a._data < b._data; }
+    [[nodiscard]] constexpr friend bool operator>(fixed_t a, fixed_t b) { return a._data > b._data; }
+    [[nodiscard]] constexpr friend bool operator<=(fixed_t a, fixed_t b) { return a._data <= b._data; }
+    [[nodiscard]] constexpr friend bool operator>=(fixed_t a, fixed_t b) { return a._data >= b._data; }
+
+private:
+    int _data = 0;
+};
+
+// Mixed precision arithmetic keeps the precision of the left operand
+template<int Precision, int OtherPrecision>
+    requires(Precision != OtherPrecision)
+[[nodiscard]] constexpr fixed_t<Precision> operator+(fixed_t<Precision> a, fixed_t<OtherPrecision> b)
+{
+    return a + fixed_t<Precision>(b);
+}
+
+template<int Precision, int OtherPrecision>
+    requires(Precision != OtherPrecision)
+[[nodiscard]] constexpr fixed_t<Precision> operator-(fixed_t<Precision> a, fixed_t<OtherPrecision> b)
+{
+    return a - fixed_t<Precision>(b);
+}
+
+template<int Precision, int OtherPrecision>
+    requires(Precision != OtherPrecision)
+[[nodiscard]] constexpr fixed_t<Precision> operator*(fixed_t<Precision> a, fixed_t<OtherPrecision> b)
+{
+    return a * fixed_t<Precision>(b);
+}
+
+using fixed = fixed_t<12>;
+
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for Butano's bn_utility.h.
+
+#include <utility>
+
+namespace bn
+{
+    using std::pair;
+    using std::make_pair;
+    using std::move;
+    using std::swap;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+// Host stand-in for Butano's bn_vector.h: fixed capacity, int sizes, no heap.
+
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace bn
+{
+
+template<typename Type, int MaxSize>
+class vector
+{
+    static_assert(MaxSize > 0);
+
+public:
+    using value_type = Type;
+    using size_type = int;
+    using reference = Type &;
+    using const_reference = const Type &;
+    using iterator = Type *;
+    using const_iterator = const Type *;
+
+    vector() = default;
+
+    vector(const vector &other)
+    {
+        for (const Type &value : other)
+            push_back(value);
+    }
+
+    vector &operator=(const vector &other)
+    {
+        if (this != &other)
+        {
+            clear();
+            for (const Type &value : other)
+                push_back(value);
+        }
+        return *this;
+    }
+
+    ~vector() { clear(); }
+
+    [[nodiscard]] int size() const { return _size; }
+    [[nodiscard]] static constexpr int max_size() { return MaxSize; }
+    [[nodiscard]] bool empty() const { return _size == 0; }
+    [[nodiscard]] bool full() const { return _size == MaxSize; }
+
+    [[nodiscard]] Type *data() { return reinterpret_cast<Type *>(_storage); }
+    [[nodiscard]] const Type *data() const { return reinterpret_cast<const Type *>(_storage); }
+
+    [[nodiscard]] iterator begin() { return data(); }
+    [[nodiscard]] iterator end() { return data() + _size; }
+    [[nodiscard]] const_iterator begin() const { return data(); }
+    [[nodiscard]] const_iterator end() const { return data() + _size; }
+    [[nodiscard]] const_iterator cbegin() const { return data(); }
+    [[nodiscard]] const_iterator cend() const { return data() + _size; }
+
+    [[nodiscard]] Type &operator[](int index) { assert(index >= 0 && index < _size); return data()[index]; }
+    [[nodiscard]] const Type &operator[](int index) const { assert(index >= 0 && index < _size); return data()[index]; }
+    [[nodiscard]] Type &at(int index) { assert(index >= 0 && index < _size); return data()[index]; }
+    [[nodiscard]] const Type &at(int index) const { assert(index >= 0 && index < _size); return data()[index]; }
+    [[nodiscard]] Type &front() { return (*this)[0]; }
+    [[nodiscard]] Type &back() { return (*this)[_size - 1]; }
+    [[nodiscard]] const Type &front() const { return (*this)[0]; }
+    [[nodiscard]] const Type &back() const { return (*this)[_size - 1]; }
+
+    void push_back(const Type &value)
+    {
+        assert(!full());
+        ::new (data() + _size) Type(value);
+        ++_size;
+    }
+
+    void push_back(Type &&value)
+    {
+        assert(!full());
+        ::new (data() + _size) Type(std::move(value));
+        ++_size;
+    }
+
+    template<typename... Args>
+    Type &emplace_back(Args &&...args)
+    {
+        assert(!full());
+        Type *result = ::new (data() + _size) Type(std::forward<Args>(args)...);
+        ++_size;
+        return *result;
+    }
+
+    void pop_back()
+    {
+        assert(!empty());
+        --_size;
+        data()[_size].~Type();
+    }
+
+    iterator erase(const_iterator position)
+    {
+        return erase(position, position + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        iterator out = begin() + (first - begin());
+        iterator in = begin() + (last - begin());
+        iterator result = out;
+
+        while (in != end())
+            *out++ = std::move(*in++);
+
+        while (end() != out)
+            pop_back();
+
+        return result;
+    }
+
+    void resize(int count)
+    {
+        assert(count >= 0 && count <= MaxSize);
+        while (_size > count)
+            pop_back();
+        while (_size < count)
+            emplace_back();
+    }
+
+    void clear()
+    {
+        while (_size)
+            pop_back();
+    }
+
+private:
+    alignas(Type) unsigned char _storage[sizeof(Type) * MaxSize];
+    int _size = 0;
+};
+
+}
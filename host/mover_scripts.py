@@ -0,0 +1,40 @@
+"""Assembles the mover scripts of the host scenarios with scripts/convert-tiles.py, so they go through the same
+assembler as the `script` property of a Tiled mover object. Writes a header with one code array per level and the
+offset of each script in it, in the order the scripts are listed."""
+import importlib.util, os, sys
+
+CONVERTER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "scripts", "convert-tiles.py")
+
+# Scripts by level, then by the name their offset constant gets
+LEVELS = {
+    "mover_course": {
+        # A lift that rises with whatever stands on it
+        "lift": "top: wait 100; move 0 -1 128; wait 60; move 0 1 128; goto top",
+        # A crusher that drops when the player comes near
+        "crusher": "top: near 48; hazard on; move 0 4 48; hazard off; wait 30; move 0 -1 192; goto top",
+        # A hazard pacing the far end
+        "pacer": "hazard on; top: repeat 3; pace: move 2 0 32; move -2 0 32; next pace; wait 60; goto top",
+    },
+}
+
+
+def main(path):
+    spec = importlib.util.spec_from_file_location("convert_tiles", CONVERTER)
+    converter = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(converter)
+
+    header = "#pragma once\n\n// Generated by host/mover_scripts.py\n\n#include <cstdint>\n"
+    for level, scripts in LEVELS.items():
+        header += "\n"
+        code = []
+        for name, text in scripts.items():
+            header += f"constexpr uint16_t {level}_{name} = {len(code)};\n"
+            code += converter.mover_script(text, f"{level}: {name}")
+        header += f"inline constexpr uint8_t {level}_code[] = {{\n{converter.c_bytes(code)}\n}};\n"
+
+    with open(path, "w") as f:
+        f.write(header)
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1]))
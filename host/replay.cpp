@@ -0,0 +1,187 @@
+// Session replay check for the simulation core.
+// Replays a session recorded in game (the SRAM save) or by --record, frame by frame, and stops at the first
+// frame whose world hash differs from the recording. --check-rewind plays and rewinds like the ROM does with
+// SELECT and checks that the session it would save right after replays cleanly.
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "entities.h"
+#include "rewind.h"
+#include "session.h"
+#include "scenarios.h"
+
+namespace
+{
+
+session_data session;
+
+int replay(const char *path)
+{
+    std::FILE *file = std::fopen(path, "rb");
+    if (!file)
+    {
+        std::fprintf(stderr, "%s: can't open\n", path);
+        return 2;
+    }
+
+    // SRAM saves can be padded past the session, only the start matters
+    std::size_t read = std::fread(&session, 1, sizeof(session), file);
+    std::fclose(file);
+
+    int frames = read >= offsetof(session_data, frames) ? session_frames(session) : 0;
+    if (frames == 0 || read < offsetof(session_data, frames) + frames * sizeof(session_frame))
+    {
+        std::fprintf(stderr, "%s: not a session, or an empty one\n", path);
+        return 2;
+    }
+    if (session.level_index >= LEVEL_COUNT)
+    {
+        std::fprintf(stderr, "%s: unknown level %d\n", path, session.level_index);
+        return 2;
+    }
+
+    loaded_level level(*level_assets[session.level_index]);
+    world game(level.loader.level());
+    session_replay player(session);
+    while (player.step(game))
+    {
+    }
+
+    if (player.diverged())
+    {
+        std::printf("%s: level %d, diverged at frame %d of %d: hash %04x, recorded %04x\n", path,
+                    session.level_index, player.frames() - 1, frames, player.actual_hash(), player.expected_hash());
+        return 1;
+    }
+
+    std::printf("%s: level %d, %d frames match\n", path, session.level_index, frames);
+    return 0;
+}
+
+// Replays the recorder's session on a fresh world, as pressing START does, and reports whether every frame matched
+bool replays_cleanly(const char *what, session_recorder &recorder, int expected_frames)
+{
+    int frames = session_frames(recorder.data());
+    if (frames != expected_frames)
+    {
+        std::printf("%s: the session holds %d frames, the world is at frame %d\n", what, frames, expected_frames);
+        return false;
+    }
+
+    world game(demo01_level.loader.level());
+    session_replay player(recorder.data());
+    while (player.step(game))
+    {
+    }
+
+    if (player.diverged())
+    {
+        std::printf("%s: diverged at frame %d of %d: hash %04x, recorded %04x\n", what, player.frames() - 1, frames,
+                    player.actual_hash(), player.expected_hash());
+        return false;
+    }
+
+    std::printf("%s: %d frames match\n", what, frames);
+    return true;
+}
+
+// Plays the scripted demo01 run, holds SELECT for a while and checks the session saved right after the rewind,
+// then plays on with different input and checks it again
+int check_rewind(int frames, int rewind_frames)
+{
+    world game(demo01_level.loader.level());
+    rewind_buffer history;
+    history.reset(game, 0, 0);
+    session_recorder recorder;
+    recorder.start(0);
+
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        int input = scripted_input(demo01_script, script_size(demo01_script), frame);
+        game.update(input);
+        recorder.record(game, input);
+        history.record(game, 0, 0);
+    }
+
+    fixed camera_x, camera_y;
+    for (int frame = 0; frame < rewind_frames; ++frame)
+    {
+        history.step_back(game, camera_x, camera_y);
+        recorder.rewound(game);
+    }
+
+    bool clean = replays_cleanly("saved after rewind", recorder, game.frame);
+
+    // Play on from the restored frame with the script from a different point, so the undone frames are rewritten
+    for (int frame = 0; frame < rewind_frames / 2; ++frame)
+    {
+        int input = scripted_input(demo01_script, script_size(demo01_script), frame);
+        game.update(input);
+        recorder.record(game, input);
+        history.record(game, 0, 0);
+    }
+
+    clean = replays_cleanly("saved after playing on", recorder, game.frame) && clean;
+    return clean ? 0 : 1;
+}
+
+// Records the scripted demo01 run as a session, the same script the benchmarks use
+int record(const char *path, int frames)
+{
+    world game(demo01_level.loader.level());
+    session_recorder recorder;
+    recorder.start(0);
+
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        int input = scripted_input(demo01_script, script_size(demo01_script), frame);
+        game.update(input);
+        recorder.record(game, input);
+    }
+
+    std::FILE *file = std::fopen(path, "wb");
+    if (!file)
+    {
+        std::fprintf(stderr, "%s: can't create\n", path);
+        return 2;
+    }
+
+    std::size_t size = offsetof(session_data, frames) + frames * sizeof(session_frame);
+    bool written = std::fwrite(&recorder.data(), 1, size, file) == size;
+    written = std::fclose(file) == 0 && written;
+    if (!written)
+    {
+        std::fprintf(stderr, "%s: write failed\n", path);
+        return 2;
+    }
+
+    std::printf("%s: recorded %d frames of demo01\n", path, frames);
+    return 0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && std::strcmp(argv[1], "--record") == 0)
+    {
+        int frames = argc > 3 ? std::atoi(argv[3]) : 3600;
+        if (frames > 0 && frames <= SESSION_MAX_FRAMES)
+            return record(argv[2], frames);
+    }
+    else if (argc == 2 && std::strcmp(argv[1], "--check-rewind") == 0)
+    {
+        return check_rewind(600, 240);
+    }
+    else if (argc == 2)
+    {
+        return replay(argv[1]);
+    }
+
+    std::fprintf(stderr, "usage: %s session\n       %s --record session [frames]\n       %s --check-rewind\n", argv[0],
+                 argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "physics.h"
+#include "maps.h"
+#include "level_loader.h"
+#include "input_script.h"
+#include "movers.h"
+#include "mover_scripts.h"
+
+// A level plus the input script that drives it; the script loops until the run ends
+struct scenario
+{
+    const char *name;
+    const level_ptr &level;
+    const input_run *script;
+    int script_size;
+};
+
+// Returns the input code for a frame of a scenario's looping script
+inline int scripted_input(const scenario &s, int frame)
+{
+    return scripted_input(s.script, s.script_size, frame);
+}
+
+// Level decompressed in one go, the ROM spreads the same decode across frames
+struct loaded_level
+{
+    explicit loaded_level(const level_asset &asset)
+        : arena(level_loader::arena_bytes(asset)), loader(arena.data(), int(arena.size()))
+    {
+        loader.start(asset);
+        while (!loader.update())
+        {
+        }
+    }
+
+    std::vector<uint8_t> arena;
+    level_loader loader;
+};
+
+inline const loaded_level demo01_level(demo01);
+
+// Tile characters of ASCII levels, a tile's collision value is its place in this string plus one
+constexpr char ASCII_TILES[] = "#=^~>|";
+inline constexpr uint8_t ASCII_TILE_ATTRIBUTES[COLLISION_MASK + 1] = {
+    0, TILE_SOLID, TILE_ONE_WAY, TILE_SOLID | TILE_HAZARD, TILE_SOLID | TILE_ICE, TILE_SOLID | TILE_CONVEYOR,
+    TILE_CLONE_BLOCKER,
+};
+
+// Level built from ASCII art at startup, anything not in ASCII_TILES is empty:
+// '#' solid, '=' one-way platform, '^' hazard, '~' ice, '>' conveyor, '|' clone blocker
+struct ascii_level
+{
+    ascii_level(const char *tiles, int width, int height, int init_x, int init_y, int loop_frames = 256,
+                level_table<level_mover> movers = {}, const uint8_t *mover_code = nullptr,
+                physics_preset physics = PHYSICS_DEFAULT)
+    {
+        int stride_shift = 1;
+        while ((1 << stride_shift) < width)
+            ++stride_shift;
+
+        collisions.resize(((1 << stride_shift) * height) / 2);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                int index = (y << stride_shift) | x;
+                const char *tile = std::strchr(ASCII_TILES, tiles[y * width + x]);
+                if (tile && *tile)
+                    collisions[index >> 1] |= (1 + tile - ASCII_TILES) << ((index & 1) * COLLISION_BITS);
+            }
+        }
+
+        level = {nullptr, collisions.data(), stride_shift, width, height, init_x, init_y, loop_frames,
+                 ASCII_TILE_ATTRIBUTES};
+        level.physics = physics;
+        level.movers = movers;
+        level.mover_code = mover_code;
+    }
+
+    std::vector<uint8_t> collisions;
+    level_ptr level;
+};
+
+// Flat room: clones are dropped in a row and then shoved as a group
+inline const ascii_level push_room(
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "######################",
+    22, 10, 2, 8);
+
+// Narrow shaft: clones are spawned mid-jump so they land on each other
+inline const ascii_level stack_shaft(
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "##....##"
+    "########",
+    8, 16, 3, 14);
+
+// Obstacle course run at dash speed
+inline const ascii_level dash_course(
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "......#.......#......."
+    "......#....#..#....#.."
+    "...#..#....#..#....#.."
+    "######################",
+    22, 9, 1, 7);
+
+// Open room with a solid bottom row, for levels too wide to write out by hand
+inline std::string flat_floor(int width, int height)
+{
+    std::string tiles(width * (height - 1), '.');
+    tiles.append(width, '#');
+    return tiles;
+}
+
+// Long floor for the crowd run: the player walks right dropping a clone every loop, so the pool fills up
+// with clones that each pace their own stretch of floor instead of blocking each other's respawn
+inline const ascii_level crowd_floor(flat_floor(240, 8).c_str(), 240, 8, 1, 6, 64);
+
+// Typed terrain: ice, then a conveyor, a one-way platform to jump up through, a gate only the player gets past and
+// a hazard that sends the player back to the start
+inline const ascii_level terrain_course(
+    "........................................"
+    "........................................"
+    "........................................"
+    "........................................"
+    "........................................"
+    "........................................"
+    "................................|......."
+    "........................=====...|......."
+    "................................|......."
+    "#######~~~~~~~~>>>>>>###############^^##",
+    40, 10, 1, 8, 512);
+
+// Lift, crusher and pacing hazard, assembled from host/mover_scripts.py by the converter
+inline constexpr level_mover mover_course_movers[] = {
+    {{240, 272}, mover_course_lift}, {{560, 80}, mover_course_crusher}, {{816, 272}, mover_course_pacer},
+};
+
+// Floor with a ledge the lift reaches, a crusher over the gap beyond and a hazard at the end
+inline const ascii_level mover_course(
+    "............................"
+    "............................"
+    "............................"
+    "............................"
+    "............................"
+    "........######.............."
+    "........######.............."
+    "........######.............."
+    "........######.............."
+    "############################",
+    28, 10, 1, 8, 256, {mover_course_movers, 3}, mover_course_code);
+
+// Low gravity: steps two tiles high, taken with a jump and a second one in mid air
+inline const ascii_level float_course(
+    "......................"
+    "......................"
+    "......................"
+    "......................"
+    "..............####...."
+    "..............####...."
+    ".......###....####...."
+    ".......###....####...."
+    "######################",
+    22, 9, 1, 7, 256, {}, nullptr, PHYSICS_LOW_GRAVITY);
+
+inline const input_run push_room_script[] = {
+    {1, SPAWN}, {40, RIGHT}, {1, SPAWN}, {40, RIGHT}, {1, SPAWN}, {40, RIGHT}, {1, SPAWN},
+    {60, LEFT}, {200, RIGHT}, {200, LEFT | DASH}, {1, JUMP}, {120, RIGHT},
+};
+
+inline const input_run stack_shaft_script[] = {
+    {1, JUMP}, {10, 0}, {1, SPAWN}, {30, 0}, {1, JUMP}, {10, 0}, {1, SPAWN}, {30, 0},
+    {1, JUMP}, {10, 0}, {1, SPAWN}, {30, 0}, {1, JUMP}, {10, 0}, {1, SPAWN}, {20, LEFT}, {20, RIGHT}, {90, 0},
+};
+
+inline const input_run dash_course_script[] = {
+    {1, SPAWN}, {20, RIGHT | DASH}, {1, RIGHT | DASH | JUMP}, {40, RIGHT | DASH}, {1, RIGHT | DASH | JUMP},
+    {60, RIGHT | DASH}, {1, SPAWN}, {20, LEFT | DASH}, {1, LEFT | DASH | JUMP}, {80, LEFT | DASH}, {1, JUMP}, {60, LEFT},
+};
+
+inline const input_run crowd_floor_script[] = {
+    {1, SPAWN}, {30, RIGHT}, {1, RIGHT | JUMP}, {32, RIGHT},
+};
+
+inline const input_run terrain_course_script[] = {
+    {1, SPAWN}, {200, RIGHT}, {1, RIGHT | JUMP}, {110, RIGHT}, {1, RIGHT | JUMP}, {120, RIGHT},
+};
+
+inline const input_run mover_course_script[] = {
+    {1, SPAWN}, {80, RIGHT}, {1, RIGHT | JUMP}, {14, RIGHT}, {140, 0}, {120, RIGHT}, {1, RIGHT | JUMP}, {60, RIGHT},
+};
+
+inline const input_run float_course_script[] = {
+    {1, SPAWN}, {40, RIGHT}, {1, RIGHT | JUMP}, {30, RIGHT}, {1, RIGHT | JUMP}, {80, RIGHT}, {1, RIGHT | JUMP},
+    {20, RIGHT}, {1, RIGHT | JUMP}, {80, RIGHT}, {1, LEFT | JUMP}, {120, LEFT},
+};
+
+inline const scenario scenarios[] = {
+    {"demo01", demo01_level.loader.level(), demo01_script, script_size(demo01_script)},
+    {"push_room", push_room.level, push_room_script, script_size(push_room_script)},
+    {"stack_shaft", stack_shaft.level, stack_shaft_script, script_size(stack_shaft_script)},
+    {"dash_course", dash_course.level, dash_course_script, script_size(dash_course_script)},
+    {"crowd_floor", crowd_floor.level, crowd_floor_script, script_size(crowd_floor_script)},
+    {"terrain_course", terrain_course.level, terrain_course_script, script_size(terrain_course_script)},
+    {"mover_course", mover_course.level, mover_course_script, script_size(mover_course_script)},
+    {"float_course", float_course.level, float_course_script, script_size(float_course_script)},
+};
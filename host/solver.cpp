@@ -0,0 +1,537 @@
+// Shortest-input search over a level for the simulation core.
+// Explores input sequences breadth first in fixed-length steps, clone spawns included, until the player touches
+// a goal. Every depth is expanded by all cores: each starts on its own share of the frontier, and one that runs
+// dry steals the back half of whatever another has left. States reached before, by any path, are dropped by hash.
+// Children are merged in (parent, input) order before dropping duplicates, so the thread count and scheduling
+// never change the result.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "physics.h"
+#include "entities.h"
+#include "scenarios.h"
+
+namespace
+{
+
+constexpr int STATE_SIZE = world::state_size();
+
+// Frontier nodes a worker takes from its range at a time, large enough that the range locks stay cold
+constexpr int CHUNK_NODES = 16;
+
+// Input tried at each step: the code on its first frame, then the code held for the rest of it.
+// Jumps and spawns are presses, so they only go on the first frame.
+struct step_input
+{
+    int first;
+    int held;
+};
+
+constexpr step_input STEP_INPUTS[] = {
+    {0, 0}, {LEFT, LEFT}, {RIGHT, RIGHT}, {JUMP, 0}, {LEFT | JUMP, LEFT}, {RIGHT | JUMP, RIGHT},
+    {LEFT | DASH, LEFT | DASH}, {RIGHT | DASH, RIGHT | DASH}, {SPAWN, 0},
+};
+constexpr int STEP_INPUT_COUNT = sizeof(STEP_INPUTS) / sizeof(STEP_INPUTS[0]);
+constexpr int SPAWN_INPUT = STEP_INPUT_COUNT - 1;
+
+struct options
+{
+    int step = 8;              // frames per search step
+    int max_depth = 64;        // steps
+    int max_states = 1 << 20;  // distinct states before giving up, a frontier holds a whole state image per node
+    int threads = 0;           // 0 for every core
+    bool clones = true;        // false leaves spawns out, to see if a level can be solved without clones
+};
+
+// FNV-1a over the whole state image but the frame counter at its end, which has no say in what happens next.
+// Stale bytes of dead slots are hashed too, so equal states reached by different paths may be kept twice,
+// but different states are never merged.
+uint64_t state_hash(const uint8_t *state)
+{
+    uint64_t value = 14695981039346656037ull;
+    for (int index = 0; index < STATE_SIZE - int(sizeof(int)); ++index)
+    {
+        value = (value ^ state[index]) * 1099511628211ull;
+    }
+    return value;
+}
+
+// One depth of the search: node states plus how each was reached from the previous depth
+struct frontier
+{
+    std::vector<uint8_t> states;
+    std::vector<int> parents;
+    std::vector<uint8_t> inputs;
+    std::vector<uint64_t> hashes; // state hashes, only kept until the depth is merged
+
+    int size() const { return int(parents.size()); }
+
+    void add(const uint8_t *state, int parent, int input, uint64_t hash)
+    {
+        states.insert(states.end(), state, state + STATE_SIZE);
+        parents.push_back(parent);
+        inputs.push_back(uint8_t(input));
+        hashes.push_back(hash);
+    }
+
+    const uint8_t *state(int node) const { return &states[std::size_t(node) * STATE_SIZE]; }
+};
+
+// The frontier nodes one worker has left to expand, [begin, end). The owner takes chunks from the front,
+// a thief splits off the back half, so the work is only divided when a core actually runs out.
+class work_range
+{
+public:
+    void reset(int begin, int end)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _begin = begin;
+        _end = end;
+    }
+
+    bool take(int &begin, int &end)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_begin == _end)
+            return false;
+        begin = _begin;
+        end = std::min(_begin + CHUNK_NODES, _end);
+        _begin = end;
+        return true;
+    }
+
+    bool steal(int &begin, int &end)
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_begin == _end)
+            return false;
+        begin = _begin + (_end - _begin) / 2;
+        end = _end;
+        _end = begin;
+        return true;
+    }
+
+private:
+    std::mutex _lock;
+    int _begin = 0;
+    int _end = 0;
+};
+
+// Earliest frame a goal was reached at, within the depth being expanded
+struct solution
+{
+    std::mutex lock;
+    bool found = false;
+    int frames = 0;   // into the last step
+    int node = 0;     // the node the last step started from
+    int input = 0;    // STEP_INPUTS index of the last step
+
+    void offer(int new_frames, int new_node, int new_input)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        // Ties go to the lowest node and input, not to whichever thread got there first
+        if (!found || new_frames < frames || (new_frames == frames &&
+            (new_node < node || (new_node == node && new_input < input))))
+        {
+            found = true;
+            frames = new_frames;
+            node = new_node;
+            input = new_input;
+        }
+    }
+};
+
+struct search
+{
+    const level_ptr &level;
+    entity_bounds goal;
+    options settings;
+
+    // Every depth so far, their parents and inputs rebuild the winning path.
+    // Only the last depth still needs its states, earlier ones drop them to save memory.
+    std::vector<frontier> depths;
+    std::unordered_set<uint64_t> seen; // only written between depths, so workers read it without locking
+    solution best;
+    int state_count = 0;
+    std::atomic<long long> frames_stepped{0};
+    bool full = false;
+
+    search(const level_ptr &level_, const entity_bounds &goal_, const options &settings_)
+        : level(level_), goal(goal_), settings(settings_)
+    {
+    }
+
+    bool at_goal() const
+    {
+        return bounds_overlap(physics_manager::instance().entities.bounds(PLAYER_ID), goal);
+    }
+
+    // Expands the worker's share of the last depth, and whatever it steals, on the calling thread's simulation.
+    // Children new to earlier depths all go to out, duplicates within this depth are dropped by merge().
+    void expand(std::vector<work_range> &ranges, int worker, frontier &out)
+    {
+        world game(level);
+        uint8_t state[STATE_SIZE];
+        const frontier &current = depths.back();
+        int input_count = settings.clones ? STEP_INPUT_COUNT : SPAWN_INPUT;
+        long long frames = 0;
+
+        int begin, end;
+        int worker_count = int(ranges.size());
+        while (true)
+        {
+            bool got = ranges[worker].take(begin, end);
+            for (int victim = 1; !got && victim < worker_count; ++victim)
+            {
+                // The stolen half becomes this worker's range, so others can split it again
+                if (ranges[(worker + victim) % worker_count].steal(begin, end))
+                {
+                    ranges[worker].reset(begin, end);
+                    got = ranges[worker].take(begin, end);
+                }
+            }
+            // Expanding never adds nodes to the depth, so empty ranges everywhere mean it's done
+            if (!got)
+                break;
+
+            for (int node = begin; node < end; ++node)
+            {
+                const uint8_t *start = current.state(node);
+                for (int input = 0; input < input_count; ++input)
+                {
+                    game.load_state(start);
+                    const step_input &step = STEP_INPUTS[input];
+                    bool reached = false;
+                    for (int frame = 0; frame < settings.step && !reached; ++frame)
+                    {
+                        game.update(frame == 0 ? step.first : step.held);
+                        ++frames;
+                        if (at_goal())
+                        {
+                            best.offer(frame + 1, node, input);
+                            reached = true;
+                        }
+                    }
+
+                    if (reached)
+                        continue;
+
+                    game.save_state(state);
+                    uint64_t hash = state_hash(state);
+                    if (!seen.count(hash))
+                    {
+                        out.add(state, node, input, hash);
+                    }
+                }
+            }
+        }
+
+        frames_stepped += frames;
+    }
+
+    // The next depth from every worker's children, in (parent, input) order whichever worker made them.
+    // The first child to reach a state keeps it, so the search takes the same path on any number of threads.
+    frontier merge(const std::vector<frontier> &outs)
+    {
+        struct child
+        {
+            int parent;
+            int input;
+            const frontier *out;
+            int index;
+        };
+
+        std::vector<child> children;
+        for (const frontier &out : outs)
+        {
+            for (int index = 0; index < out.size(); ++index)
+            {
+                children.push_back({out.parents[index], out.inputs[index], &out, index});
+            }
+        }
+        std::sort(children.begin(), children.end(), [](const child &a, const child &b) {
+            return a.parent != b.parent ? a.parent < b.parent : a.input < b.input;
+        });
+
+        frontier next;
+        for (const child &c : children)
+        {
+            if (state_count >= settings.max_states)
+            {
+                full = true;
+                break;
+            }
+            if (seen.insert(c.out->hashes[c.index]).second)
+            {
+                next.add(c.out->state(c.index), c.parent, c.input, c.out->hashes[c.index]);
+                ++state_count;
+            }
+        }
+        return next;
+    }
+
+    // Runs depth after depth until a goal is reached, returns the number of depths expanded
+    int run(int thread_count)
+    {
+        {
+            world game(level);
+            depths.emplace_back();
+            uint8_t state[STATE_SIZE];
+            game.save_state(state);
+            uint64_t hash = state_hash(state);
+            seen.insert(hash);
+            state_count = 1;
+            depths.back().add(state, -1, 0, hash);
+        }
+
+        for (int depth = 0; depth < settings.max_depth; ++depth)
+        {
+            // Every worker starts on an equal share of the frontier, stealing evens out the rest
+            int size = depths.back().size();
+            std::vector<work_range> ranges(thread_count);
+            for (int worker = 0; worker < thread_count; ++worker)
+            {
+                ranges[worker].reset(int(int64_t(size) * worker / thread_count),
+                                     int(int64_t(size) * (worker + 1) / thread_count));
+            }
+
+            std::vector<frontier> outs(thread_count);
+            std::vector<std::thread> workers;
+            for (int worker = 0; worker < thread_count; ++worker)
+            {
+                workers.emplace_back([this, &ranges, &outs, worker] { expand(ranges, worker, outs[worker]); });
+            }
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+
+            if (best.found)
+                return depth + 1;
+
+            frontier next = merge(outs);
+            if (next.size() == 0 || full)
+                return depth + 1;
+
+            // Parents were indices into the previous depth already, merging only moves children around
+            depths.back().states = std::vector<uint8_t>();
+            depths.back().hashes = std::vector<uint64_t>();
+            depths.push_back(std::move(next));
+        }
+
+        return settings.max_depth;
+    }
+
+    // Frame by frame input of the solution, from the level start
+    std::vector<int> solution_inputs() const
+    {
+        std::vector<int> steps;
+        steps.push_back(best.input);
+        for (int depth = int(depths.size()) - 1, node = best.node; depth > 0; --depth)
+        {
+            steps.push_back(depths[depth].inputs[node]);
+            node = depths[depth].parents[node];
+        }
+
+        std::vector<int> inputs;
+        for (int index = int(steps.size()) - 1; index >= 0; --index)
+        {
+            const step_input &step = STEP_INPUTS[steps[index]];
+            int frames = index == 0 ? best.frames : settings.step;
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                inputs.push_back(frame == 0 ? step.first : step.held);
+            }
+        }
+        return inputs;
+    }
+};
+
+// Prints an input code the way scripts spell it
+void print_input(int input)
+{
+    static const char *const names[] = {"LEFT", "RIGHT", "JUMP", "DASH", "SPAWN"};
+    if (input == 0)
+    {
+        std::printf("0");
+        return;
+    }
+
+    const char *separator = "";
+    for (int bit = 0; bit < 5; ++bit)
+    {
+        if (input & (1 << bit))
+        {
+            std::printf("%s%s", separator, names[bit]);
+            separator = " | ";
+        }
+    }
+}
+
+// Prints the solution as an input_run list, ready to paste into scenarios.h
+void print_script(const std::vector<int> &inputs)
+{
+    std::printf("    ");
+    for (std::size_t index = 0; index < inputs.size();)
+    {
+        std::size_t end = index;
+        while (end < inputs.size() && inputs[end] == inputs[index])
+            ++end;
+
+        std::printf("{%d, ", int(end - index));
+        print_input(inputs[index]);
+        std::printf("}, ");
+        index = end;
+    }
+    std::printf("\n");
+}
+
+// Replays the solution on a fresh world, a final check that it doesn't lean on anything the search got wrong
+bool verify(const search &s, const std::vector<int> &inputs)
+{
+    world game(s.level);
+    for (int input : inputs)
+    {
+        game.update(input);
+    }
+    return s.at_goal();
+}
+
+// Level by scenario name, or by index into level_assets for maps that have no scenario
+const level_ptr *find_level(const char *name)
+{
+    static std::unique_ptr<loaded_level> loaded;
+    char *end;
+    long index = std::strtol(name, &end, 10);
+    if (*end == 0)
+    {
+        if (index < 0 || index >= LEVEL_COUNT)
+            return nullptr;
+        loaded = std::make_unique<loaded_level>(*level_assets[index]);
+        return &loaded->loader.level();
+    }
+
+    for (const scenario &s : scenarios)
+    {
+        if (std::strcmp(s.name, name) == 0)
+            return &s.level;
+    }
+    return nullptr;
+}
+
+int usage(const char *program)
+{
+    std::fprintf(stderr,
+                 "usage: %s level [--goal tile_x,tile_y] [--step frames] [--depth steps] [--states count]\n"
+                 "       [--threads count] [--no-clones]\n"
+                 "level is a scenario name or an index into level_assets, the goal defaults to the level's goals\n",
+                 program);
+    return 2;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        return usage(argv[0]);
+
+    const level_ptr *level = find_level(argv[1]);
+    if (!level)
+    {
+        std::fprintf(stderr, "%s: unknown level\n", argv[1]);
+        return 2;
+    }
+
+    options settings;
+    bool goal_set = false;
+    level_rect goal_rect = {};
+    for (int arg = 2; arg < argc; ++arg)
+    {
+        bool has_value = arg + 1 < argc;
+        if (std::strcmp(argv[arg], "--goal") == 0 && has_value)
+        {
+            int tile_x, tile_y;
+            if (std::sscanf(argv[++arg], "%d,%d", &tile_x, &tile_y) != 2)
+                return usage(argv[0]);
+            goal_rect = {int16_t(to_pixel(tile_x)), int16_t(to_pixel(tile_y)), TILE_SIZE, TILE_SIZE};
+            goal_set = true;
+        }
+        else if (std::strcmp(argv[arg], "--step") == 0 && has_value)
+            settings.step = std::atoi(argv[++arg]);
+        else if (std::strcmp(argv[arg], "--depth") == 0 && has_value)
+            settings.max_depth = std::atoi(argv[++arg]);
+        else if (std::strcmp(argv[arg], "--states") == 0 && has_value)
+            settings.max_states = std::atoi(argv[++arg]);
+        else if (std::strcmp(argv[arg], "--threads") == 0 && has_value)
+            settings.threads = std::atoi(argv[++arg]);
+        else if (std::strcmp(argv[arg], "--no-clones") == 0)
+            settings.clones = false;
+        else
+            return usage(argv[0]);
+    }
+
+    if (!goal_set)
+    {
+        // Only the first goal is searched for, levels with several are expected to accept any
+        if (level->goals.count == 0)
+        {
+            std::fprintf(stderr, "%s: the level has no goal, pass --goal\n", argv[1]);
+            return 2;
+        }
+        goal_rect = level->goals.items[0];
+    }
+    if (settings.step <= 0 || settings.max_depth <= 0 || settings.max_states <= 0 || settings.threads < 0)
+        return usage(argv[0]);
+
+    int thread_count = settings.threads > 0 ? settings.threads : int(std::thread::hardware_concurrency());
+    if (thread_count <= 0)
+        thread_count = 1;
+
+    entity_bounds goal(goal_rect.x + goal_rect.width / 2, goal_rect.y + goal_rect.height / 2,
+                       goal_rect.width, goal_rect.height);
+    search s(*level, goal, settings);
+
+    auto start = std::chrono::steady_clock::now();
+    int depth = s.run(thread_count);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    int states = s.state_count;
+    long long frames = s.frames_stepped;
+    std::printf("%s: %d steps of %d frames searched on %d thread%s, %d states, %.0f states/s, %.0f frames/s\n",
+                argv[1], depth, settings.step, thread_count, thread_count == 1 ? "" : "s", states, states / seconds,
+                frames / seconds);
+
+    if (!s.best.found)
+    {
+        std::printf("no solution%s\n", s.full ? " before the state limit" : "");
+        return 1;
+    }
+
+    std::vector<int> inputs = s.solution_inputs();
+    int spawns = 0;
+    for (int input : inputs)
+    {
+        spawns += (input & SPAWN) != 0;
+    }
+    std::printf("solved in %d frames with %d clone%s:\n", int(inputs.size()), spawns, spawns == 1 ? "" : "s");
+    print_script(inputs);
+
+    if (!verify(s, inputs))
+    {
+        std::printf("MISMATCH: the solution doesn't reach the goal when replayed\n");
+        return 1;
+    }
+    return 0;
+}
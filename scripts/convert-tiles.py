@@ -1,77 +1,452 @@
-import os, json
-
-final = """// Level structure
-struct level_ptr
-{
-    const regular_bg_item *bg_item;
-    const int collisions[512];
-    int size_x;
-    int size_y;
-    int init_x;
-    int init_y;
-};\n\n"""
-
-for tile in os.listdir(os.path.join("tilesets", "maps_json")):
-    with open(os.path.join("tilesets", "maps_json", tile), "r") as f:
-        data = json.load(f)
-
-    name = tile.replace(".tmj", "")
-    grid = str(data["layers"][0]["data"]).replace("[", "{").replace("]", "}")
-    width = data["layers"][0]["width"]
-    height = data["layers"][0]["height"]
-    template = f"const level_ptr {name} = {{&regular_bg_items::{name}, {grid}, {width}, {height}, 0, 0}};"
-
-    final += f"#include <bn_regular_bg_items_{name}.h>\n"
-    final += template + "\n\n"
-
-with open(os.path.join("src", "maps.h"), "w") as f:
-    f.write(final)
-
-from PIL import Image
-import numpy as np
-
-for image in os.listdir("graphics/maps_raw/"):
-    file_path = "graphics/maps_raw/" + image
-    
+import os, sys, io, json, base64, zlib, gzip, hashlib
+import xml.etree.ElementTree as ElementTree
+from concurrent.futures import ProcessPoolExecutor
+
+COLLISION_BITS = 4
+MAX_LOOP_FRAMES = 512  # longest clone loop the input logs hold, MAX_LOOP_FRAMES in src/level.h
+TILE_SIZE = 32  # level tile size in pixels, TILE_SHIFT in src/physics.h
+SCREEN_HEIGHT = 160  # scanlines, one parallax offset each
+
+# Physics presets by the name the physics map property gives them, physics_preset in src/level.h
+PHYSICS_PRESETS = {"default": "PHYSICS_DEFAULT", "low_gravity": "PHYSICS_LOW_GRAVITY"}
+
+# Tile attribute flags by their Tiled bool property name, TILE_* in src/level.h.
+# Tiles are solid unless their tileset says otherwise.
+TILE_ATTRIBUTES = {"solid": 1, "one_way": 2, "hazard": 4, "ice": 8, "conveyor": 16, "clone_blocker": 32}
+DEFAULT_TILE_ATTRIBUTES = TILE_ATTRIBUTES["solid"]
+
+# Tiled stores flips in the top bits of a tile id, collisions only care about the tile
+GID_MASK = 0x0fffffff
+
+TILESETS_DIR = "tilesets"
+MAPS_JSON_DIR = os.path.join("tilesets", "maps_json")
+MAPS_RAW_DIR = os.path.join("graphics", "maps_raw")
+MAPS_OUT_DIR = os.path.join("graphics", "maps")
+BACKGROUNDS_DIR = os.path.join("graphics", "backgrounds")
+MAPS_HEADER = os.path.join("src", "maps.h")
+
+# Level backgrounds are 4bpp: one 16 color palette bank each, and tile indices are 10 bits in a map cell.
+# Every background a level shows, the parallax one included, shares that tile budget.
+BG_PALETTE_COLORS = 16
+BG_TILE_LIMIT = 1024
+BG_TILE_BYTES = 32
+CELL_HFLIP = 1 << 10
+CELL_VFLIP = 1 << 11
+
+# Mover script opcodes and their operand counts, mover_opcode and MOVER_OPERANDS in src/movers.h
+MOVER_OPCODES = {"end": (0, 0), "move": (1, 3), "wait": (2, 1), "goto": (3, 1), "repeat": (4, 1), "next": (5, 1),
+                 "near": (6, 1), "hazard": (7, 1)}
+MOVER_SCRIPT_LIMIT = 256  # program counters are a byte
+MOVER_SUBPIXELS = 16  # move speeds are in sixteenths of a pixel per frame, like entity velocities
+ENTITY_SIZE = 32  # mover boxes and sprites, ENTITY_SIZE in src/physics.h
+
+# Input hashes of the last run, a map is only converted again when it or this script changed
+CACHE_PATH = os.path.join("build", "convert-tiles-cache.json")
+
+
+def pack_collisions(data, width, height):
+    """Packs a Tiled layer into 4-bit cells, rows padded to a power-of-two stride (see src/level.h)."""
+    stride_shift = max(1, (width - 1).bit_length())
+    stride = 1 << stride_shift
+    cells = bytearray((stride * height) // 2)
+
+    for y in range(height):
+        for x in range(width):
+            value = data[y * width + x] & GID_MASK
+            if value >= 1 << COLLISION_BITS:
+                raise ValueError(f"Tile {value} at ({x}, {y}) does not fit in {COLLISION_BITS} collision bits")
+            index = (y << stride_shift) | x
+            cells[index >> 1] |= value << ((index & 1) * COLLISION_BITS)
+
+    return stride_shift, cells
+
+
+def lz77_compress(data):
+    """Compresses to the GBA BIOS LZ77 layout decoded by src/lz77.h: greedy longest match in a 4 KiB window."""
+    size = len(data)
+    out = bytearray([0x10, size & 0xff, (size >> 8) & 0xff, (size >> 16) & 0xff])
+    recent = {}  # three byte prefix -> positions it was seen at, newest last
+    position = 0
+
+    def remember(start, end):
+        for i in range(start, min(end, size - 2)):
+            recent.setdefault(bytes(data[i:i + 3]), []).append(i)
+
+    while position < size:
+        flag_index = len(out)
+        out.append(0)
+
+        for bit in range(8):
+            if position >= size:
+                break
+
+            best_length, best_distance = 0, 0
+            for candidate in reversed(recent.get(bytes(data[position:position + 3]), [])[-64:]):
+                distance = position - candidate
+                if distance > 4096:
+                    break
+                length = 0
+                while length < 18 and position + length < size and data[candidate + length] == data[position + length]:
+                    length += 1
+                if length > best_length:
+                    best_length, best_distance = length, distance
+                    if length == 18:
+                        break
+
+            if best_length >= 3:
+                out[flag_index] |= 0x80 >> bit
+                out += bytes([((best_length - 3) << 4) | ((best_distance - 1) >> 8), (best_distance - 1) & 0xff])
+                remember(position, position + best_length)
+                position += best_length
+            else:
+                out.append(data[position])
+                remember(position, position + 1)
+                position += 1
+
+    return out
+
+
+def c_bytes(data, per_line=16):
+    return "\n".join("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + per_line]) + ","
+                     for i in range(0, len(data), per_line))
+
+
+def property_value(kind, value):
+    """A Tiled custom property as a Python value, TMX stores every value as a string."""
+    if kind == "bool":
+        return value in (True, "true")
+    if kind in ("int", "object"):
+        return int(value)
+    if kind == "float":
+        return float(value)
+    return value
+
+
+def json_properties(owner):
+    return {p["name"]: property_value(p.get("type", "string"), p["value"]) for p in owner.get("properties", [])}
+
+
+def xml_properties(owner):
+    properties = owner.find("properties")
+    if properties is None:
+        return {}
+    return {p.get("name"): property_value(p.get("type", "string"), p.get("value", p.text))
+            for p in properties.findall("property")}
+
+
+def xml_layer_data(data, size):
+    """Tile ids of a TMX layer, CSV or base64 with optional zlib or gzip compression."""
+    encoding = data.get("encoding")
+    if encoding == "csv":
+        return [int(value) for value in data.text.split(",")]
+    if encoding == "base64":
+        raw = base64.b64decode(data.text.strip())
+        compression = data.get("compression")
+        if compression == "zlib":
+            raw = zlib.decompress(raw)
+        elif compression == "gzip":
+            raw = gzip.decompress(raw)
+        elif compression:
+            raise ValueError(f"Unsupported layer compression {compression}, save the map with zlib or CSV")
+        return [int.from_bytes(raw[i:i + 4], "little") for i in range(0, size * 4, 4)]
+    return [int(tile.get("gid", 0)) for tile in data.findall("tile")]
+
+
+def read_tileset(path):
+    """Tile properties of an external .tsx tileset, by tile id."""
+    root = ElementTree.parse(path).getroot()
+    return {int(tile.get("id")): xml_properties(tile) for tile in root.findall("tile")}
+
+
+def read_tiled_map(path):
+    """A .tmj or .tmx map as one dict: size, tile size, the first tile layer, tilesets, objects and map properties.
+    Tilesets are (first tile id, {tile id: properties}) pairs, objects carry their class, pixel area and properties."""
+    folder = os.path.dirname(path)
+    level = {"tilesets": [], "objects": []}
+
+    if path.endswith(".tmj"):
+        with open(path, "r") as f:
+            data = json.load(f)
+
+        tile_layer = next(layer for layer in data["layers"] if layer["type"] == "tilelayer")
+        level.update(width=tile_layer["width"], height=tile_layer["height"], tiles=tile_layer["data"],
+                     tile_size=(data["tilewidth"], data["tileheight"]), properties=json_properties(data))
+
+        for tileset in data.get("tilesets", []):
+            if "source" in tileset:
+                tiles = read_tileset(os.path.join(folder, tileset["source"]))
+            else:
+                tiles = {tile["id"]: json_properties(tile) for tile in tileset.get("tiles", [])}
+            level["tilesets"].append((tileset["firstgid"], tiles))
+
+        for layer in data["layers"]:
+            for item in layer.get("objects", []) if layer["type"] == "objectgroup" else []:
+                level["objects"].append({"class": item.get("type", item.get("class", "")), "id": item["id"],
+                                         "x": item["x"], "y": item["y"],
+                                         "width": item.get("width", 0), "height": item.get("height", 0),
+                                         "properties": json_properties(item)})
+        return level
+
+    root = ElementTree.parse(path).getroot()
+    tile_layer = root.find("layer")
+    width, height = int(tile_layer.get("width")), int(tile_layer.get("height"))
+    level.update(width=width, height=height, tiles=xml_layer_data(tile_layer.find("data"), width * height),
+                 tile_size=(int(root.get("tilewidth")), int(root.get("tileheight"))), properties=xml_properties(root))
+
+    for tileset in root.findall("tileset"):
+        if tileset.get("source"):
+            tiles = read_tileset(os.path.join(folder, tileset.get("source")))
+        else:
+            tiles = {int(tile.get("id")): xml_properties(tile) for tile in tileset.findall("tile")}
+        level["tilesets"].append((int(tileset.get("firstgid")), tiles))
+
+    for group in root.findall("objectgroup"):
+        for item in group.findall("object"):
+            level["objects"].append({"class": item.get("type", item.get("class", "")), "id": int(item.get("id")),
+                                     "x": float(item.get("x", 0)), "y": float(item.get("y", 0)),
+                                     "width": float(item.get("width", 0)), "height": float(item.get("height", 0)),
+                                     "properties": xml_properties(item)})
+    return level
+
+
+def tile_attributes(tilesets):
+    """TILE_* flags for every collision value, from the bool properties of the tile each value stands for."""
+    table = [0] * (1 << COLLISION_BITS)
+    for value in range(1, len(table)):
+        first, tiles = max(((first, tiles) for first, tiles in tilesets if first <= value),
+                           default=(1, {}), key=lambda tileset: tileset[0])
+        properties = tiles.get(value - first, {})
+
+        flags = DEFAULT_TILE_ATTRIBUTES
+        for name, bit in TILE_ATTRIBUTES.items():
+            if name in properties:
+                flags = flags | bit if properties[name] else flags & ~bit
+        table[value] = flags
+    return table
+
+
+def parallax_bands(text, path):
+    """The parallax map property, "top:factor[:slope]" bands separated by commas, as (top, factor, slope) in the
+    1/4096ths level.h stores them. factor is the band's share of camera movement, slope what each line below the
+    band's top adds to it."""
+    bands = []
+    for band in filter(None, (part.strip() for part in text.split(","))):
+        fields = band.split(":")
+        if len(fields) not in (2, 3):
+            raise ValueError(f"{path}: parallax band '{band}' is not top:factor or top:factor:slope")
+        top = int(fields[0])
+        factor, slope = (round(float(field) * 4096) for field in (fields[1:] + ["0"])[:2])
+        if not 0 <= top < SCREEN_HEIGHT or (bands and top <= bands[-1][0]) or (not bands and top != 0):
+            raise ValueError(f"{path}: parallax bands must start at line 0 and go down the screen")
+        if not -32768 <= factor < 32768 or not -32768 <= slope < 32768:
+            raise ValueError(f"{path}: parallax band '{band}' is out of range")
+        bands.append((top, factor, slope))
+    return bands
+
+
+def mover_script(text, where):
+    """Assembles a mover's script property into bytecode. Instructions are separated by newlines or semicolons:
+    "move dx dy frames" with dx and dy in pixels per frame, "wait frames", "goto label", "repeat count",
+    "next label", "near pixels", "hazard on|off" and "end"; "name:" in front labels an instruction."""
+    lines = [line.split() for line in text.replace(";", "\n").splitlines() if line.strip()]
+
+    # Moves and waits longer than an operand byte are split, labels are resolved once every size is known
+    code, labels, fixups = [], {}, []
+    for fields in lines:
+        while fields and fields[0].endswith(":"):
+            labels[fields.pop(0)[:-1]] = len(code)
+        if not fields:
+            continue
+        op, args = fields[0].lower(), fields[1:]
+        if op not in MOVER_OPCODES or len(args) != MOVER_OPCODES[op][1]:
+            raise ValueError(f"{where}: bad mover instruction '{' '.join(fields)}'")
+        opcode = MOVER_OPCODES[op][0]
+
+        if op in ("move", "wait"):
+            speeds = [round(float(arg) * MOVER_SUBPIXELS) for arg in args[:-1]]
+            if any(not -128 <= speed < 128 for speed in speeds):
+                raise ValueError(f"{where}: mover speed in '{' '.join(fields)}' is out of range")
+            frames = int(args[-1])
+            while frames > 0:
+                code += [opcode] + [speed & 0xff for speed in speeds] + [min(frames, 255)]
+                frames -= 255
+        elif op in ("goto", "next"):
+            fixups.append((len(code) + 1, args[0]))
+            code += [opcode, 0]
+        elif op == "hazard":
+            if args[0] not in ("on", "off"):
+                raise ValueError(f"{where}: hazard takes on or off, not '{args[0]}'")
+            code += [opcode, int(args[0] == "on")]
+        else:
+            # The loop counter is counted down before it's tested, so a count of 0 would loop 256 times
+            value = int(args[0]) if args else None
+            if value is not None and not (1 if op == "repeat" else 0) <= value < 256:
+                raise ValueError(f"{where}: operand of '{' '.join(fields)}' is out of range")
+            code += [opcode] + ([value] if args else [])
+
+    code.append(MOVER_OPCODES["end"][0])
+    for offset, label in fixups:
+        if label not in labels:
+            raise ValueError(f"{where}: mover script has no label '{label}'")
+        code[offset] = labels[label]
+    if len(code) > MOVER_SCRIPT_LIMIT:
+        raise ValueError(f"{where}: mover script is {len(code)} bytes, the limit is {MOVER_SCRIPT_LIMIT}")
+    return code
+
+
+def convert_level(path):
+    """One Tiled map to its maps.h entry: a constexpr level_asset with the compressed collision layer, the tile
+    attribute table, tables of the spawn, goal, trigger and mover objects, the movers' assembled scripts and the
+    parallax background's bands."""
+    level = read_tiled_map(path)
+    name = os.path.splitext(os.path.basename(path))[0]
+    width, height = level["width"], level["height"]
+    if level["tile_size"] != (TILE_SIZE, TILE_SIZE):
+        raise ValueError(f"{path}: tiles are {level['tile_size'][0]}x{level['tile_size'][1]}, physics needs "
+                         f"{TILE_SIZE}x{TILE_SIZE}")
+    physics = level["properties"].get("physics", "default")
+    if physics not in PHYSICS_PRESETS:
+        raise ValueError(f"{path}: physics '{physics}' is not one of {', '.join(PHYSICS_PRESETS)}")
+    loop_frames = level["properties"].get("loop_frames", 256)
+    if not 1 <= loop_frames <= MAX_LOOP_FRAMES:
+        raise ValueError(f"{path}: loop_frames is {loop_frames}, clones record 1 to {MAX_LOOP_FRAMES} frames")
+    stride_shift, cells = pack_collisions(level["tiles"], width, height)
+    stream = lz77_compress(cells)
+
+    def rect(item):
+        return f"{{{round(item['x'])}, {round(item['y'])}, {round(item['width'])}, {round(item['height'])}}}"
+
+    spawns = [f"{{{round(o['x'] + o['width'] / 2)}, {round(o['y'] + o['height'] / 2)}}}"
+              for o in level["objects"] if o["class"] == "spawn"]
+    goals = [rect(o) for o in level["objects"] if o["class"] == "goal"]
+    triggers = [f"{{{rect(o)}, {o['properties'].get('event', o['id'])}}}"
+                for o in level["objects"] if o["class"] == "trigger"]
+
+    # Movers running the same script share one copy of its bytecode
+    mover_code, scripts, movers = [], {}, []
+    for o in level["objects"]:
+        if o["class"] == "mover":
+            if (round(o["width"]), round(o["height"])) != (ENTITY_SIZE, ENTITY_SIZE):
+                raise ValueError(f"{path}: mover {o['id']} is {round(o['width'])}x{round(o['height'])}, movers are "
+                                 f"{ENTITY_SIZE}x{ENTITY_SIZE}")
+            code = tuple(mover_script(o["properties"].get("script", "end"), f"{path}: mover {o['id']}"))
+            if code not in scripts:
+                scripts[code] = len(mover_code)
+                mover_code += code
+            center = f"{{{round(o['x'] + o['width'] / 2)}, {round(o['y'] + o['height'] / 2)}}}"
+            movers.append(f"{{{center}, {scripts[code]}}}")
+    if len(mover_code) > 0xffff:
+        raise ValueError(f"{path}: mover scripts take {len(mover_code)} bytes, the limit is 65535")
+
+    # The player starts in the tile holding the center of the first spawn object
+    init_x, init_y = 0, 0
+    for o in level["objects"]:
+        if o["class"] == "spawn":
+            init_x, init_y = int(o["x"] + o["width"] / 2) // TILE_SIZE, int(o["y"] + o["height"] / 2) // TILE_SIZE
+            break
+    if not (0 <= init_x < width and 0 <= init_y < height):
+        raise ValueError(f"{path}: spawn tile ({init_x}, {init_y}) is outside the map")
+
+    entry = f"// {name}: {width}x{height} tiles, {len(cells)} collision bytes compressed to {len(stream)}\n"
+    entry += f"inline constexpr uint8_t {name}_collisions[] = {{\n{c_bytes(stream)}\n}};\n"
+    entry += f"inline constexpr uint8_t {name}_tile_attributes[] = {{\n{c_bytes(tile_attributes(level['tilesets']))}\n}};\n"
+    if mover_code:
+        entry += f"inline constexpr uint8_t {name}_mover_code[] = {{\n{c_bytes(mover_code)}\n}};\n"
+
+    # A regular_bg from graphics/backgrounds behind the level, scrolled per scanline by the parallax bands
+    parallax_bg = level["properties"].get("parallax_bg", "")
+    parallax = [f"{{{top}, {factor}, {slope}}}"
+                for top, factor, slope in parallax_bands(level["properties"].get("parallax", "0:0.5"), path)]
+    includes = []
+    if parallax_bg:
+        if not os.path.exists(os.path.join(BACKGROUNDS_DIR, parallax_bg + ".bmp")):
+            raise ValueError(f"{path}: parallax background '{parallax_bg}' is not in {BACKGROUNDS_DIR}")
+        includes.append(f"bn_regular_bg_items_{parallax_bg}.h")
+    else:
+        parallax = []
+
+    tables = []
+    for table, kind, items in (("spawns", "level_point", spawns), ("goals", "level_rect", goals),
+                               ("triggers", "level_trigger", triggers), ("movers", "level_mover", movers),
+                               ("parallax", "parallax_band", parallax)):
+        if items:
+            entry += f"inline constexpr {kind} {name}_{table}[] = {{{', '.join(items)}}};\n"
+            tables.append(f"        .{table} = {{{name}_{table}, {len(items)}}},\n")
+        if table == "movers" and items:
+            tables.append(f"        .mover_code = {name}_mover_code,\n")
+
+    entry += f"""inline constexpr level_asset {name} = {{
+    .level = {{
+        .bg_item = LEVEL_BG_ITEM({name}),
+        .collisions = nullptr,
+        .stride_shift = {stride_shift},
+        .size_x = {width},
+        .size_y = {height},
+        .init_x = {init_x},
+        .init_y = {init_y},
+        .loop_frames = {loop_frames},
+        .tile_attributes = {name}_tile_attributes,
+        .physics = {PHYSICS_PRESETS[physics]},
+{"".join(tables)}{f"        .parallax_bg = LEVEL_PARALLAX_BG({parallax_bg}),{chr(10)}" if parallax_bg else ""}    }},
+    .collision_stream = {name}_collisions,
+    .collision_stream_size = sizeof({name}_collisions),
+}};
+
+"""
+    return {"name": name, "entry": entry, "includes": includes,
+            "parallax_bg": os.path.join(BACKGROUNDS_DIR, parallax_bg + ".bmp") if parallax_bg else ""}
+
+
+def nearest_palette(pixels, palette):
+    """Palette index closest to each pixel by squared RGB distance, lowest index on ties.
+    Distances are worked out once per distinct color, a screenshot has far fewer of those than pixels."""
+    import numpy as np
+
+    colors, inverse = np.unique(pixels.reshape(-1, 3), axis=0, return_inverse=True)
+    difference = colors[:, None, :].astype(np.int32) - np.array(palette, dtype=np.int32)[None, :, :]
+    nearest = (difference * difference).sum(axis=2).argmin(axis=1).astype(np.uint8)
+    return nearest[inverse.reshape(-1)].reshape(pixels.shape[:2])
+
+
+def convert_image(path):
+    """A level screenshot to a 16 color regular_bg bitmap plus its Butano json, returned as bytes per output."""
+    from PIL import Image
+    import numpy as np
+
     # Open the original image
     try:
-        img = Image.open(file_path)
+        img = Image.open(path)
     except Exception as e:
         raise ValueError(f"Could not open image file: {e}")
-    
+
     # Convert to RGB if necessary
     if img.mode != 'RGB':
         img = img.convert('RGB')
-    
+
     # Get original dimensions
     width, height = img.size
-    
-    # Find the larger dimension and round up to nearest multiple of 256
-    max_dim = max(width, height)
-    target_size = ((max_dim + 255) // 256) * 256
-    
-    # Create new square image with black background
-    square_img = Image.new('RGB', (target_size, target_size), (0, 0, 0))
-    
-    # Calculate position to center the original image
-    x_offset = (target_size - width) // 2
-    y_offset = (target_size - height) // 2
-    
-    # Paste the original image onto the black square
-    square_img.paste(img, (x_offset, y_offset))
-    
+
+    # Pad each dimension on its own to a multiple of 256 pixels, the sizes Butano accepts for big maps.
+    # The level stays at the top left so map cell (0, 0) is level pixel (0, 0), no square padding.
+    target_width = ((width + 255) // 256) * 256
+    target_height = ((height + 255) // 256) * 256
+
+    # Create new image with black background
+    padded_img = Image.new('RGB', (target_width, target_height), (0, 0, 0))
+    padded_img.paste(img, (0, 0))
+
     # Convert to indexed color with maximum 16 colors
     # First, we need to quantize the image
-    quantized_img = square_img.quantize(colors=16, method=Image.Quantize.MEDIANCUT)
-    
+    quantized_img = padded_img.quantize(colors=16, method=Image.Quantize.MEDIANCUT)
+
     # Get the palette and ensure black is first
     palette = quantized_img.getpalette()
-    
+
     # Convert palette to list of RGB tuples
     rgb_palette = []
     for i in range(0, len(palette), 3):
         rgb_palette.append((palette[i], palette[i+1], palette[i+2]))
-    
+
     # Check if black is already in palette, if not add it
     black = (0, 0, 0)
     if black not in rgb_palette:
@@ -79,64 +454,275 @@ for image in os.listdir("graphics/maps_raw/"):
         if len(rgb_palette) >= 16:
             rgb_palette = rgb_palette[:15]
         rgb_palette.append(black)
-    
+
     # Move black to first position if it's not already there
     if rgb_palette[0] != black:
         rgb_palette.remove(black)
         rgb_palette.insert(0, black)
-    
+
     # Create new palette with black first
     new_palette = []
     for r, g, b in rgb_palette:
         new_palette.extend([r, g, b])
-    
+
     # Pad palette to 256 colors (required for some BMP readers)
     while len(new_palette) < 768:  # 256 * 3
         new_palette.extend([0, 0, 0])
-    
-    # Create a new image with the reordered palette
-    final_img = Image.new('P', (target_size, target_size))
-    final_img.putpalette(new_palette)
-    
-    # Map pixels to new palette indices
-    square_array = np.array(square_img)
-    indexed_array = np.zeros((target_size, target_size), dtype=np.uint8)
-    
-    for y in range(target_size):
-        for x in range(target_size):
-            pixel = tuple(square_array[y, x])
-            # Find closest color in palette
-            min_dist = float('inf')
-            best_index = 0
-            for i, pal_color in enumerate(rgb_palette):
-                dist = sum((a - b) ** 2 for a, b in zip(pixel, pal_color))
-                if dist < min_dist:
-                    min_dist = dist
-                    best_index = i
-            indexed_array[y, x] = best_index
-    
-    # Create final indexed image
-    final_img = Image.fromarray(indexed_array, mode='P')
-    final_img.putpalette(new_palette)
-    
-    # Prepare output path
-    base_name = os.path.splitext(os.path.basename(file_path))[0]
-    output_dir = "graphics/maps"
-    os.makedirs(output_dir, exist_ok=True)
-    output_path = os.path.join(output_dir, f"{base_name}.bmp")
-    
-    # Save as BMP without color space information
-    # Use optimize=False to avoid color space info
-    final_img.save(output_path, format='BMP', optimize=False)
-
-    with open(f"graphics/maps/{base_name}.json", "w") as f:
-        f.write("""{
-            "type": "regular_bg"
-        }""")
-    
-    print(f"Image converted and saved to: {output_path}")
-    print(f"Final size: {target_size}x{target_size}")
-    print(f"Colors in palette: {len(rgb_palette)}")
-
-# Example usage:
-# convert_to_square_bitmap("input_image.jpg")
\ No newline at end of file
+
+    # Map pixels to new palette indices, whole image at once
+    indexed_array = nearest_palette(np.array(padded_img), rgb_palette)
+
+    base_name = os.path.splitext(os.path.basename(path))[0]
+    tiles, cells, flipped = dedupe_tiles(indexed_array)
+    columns, rows = target_width // 8, target_height // 8
+
+    summary = (f"{columns}x{rows} cells, {len(tiles)} unique tiles of {columns * rows} ({flipped} matched flipped), "
+               f"{len(tiles) * BG_TILE_BYTES} of {BG_TILE_LIMIT * BG_TILE_BYTES} tile VRAM bytes "
+               f"({len(tiles) * 100 // BG_TILE_LIMIT}%), {len(rgb_palette)} of {BG_PALETTE_COLORS} palette colors, "
+               f"{len(cells) * 2} map bytes in ROM")
+    if len(tiles) > BG_TILE_LIMIT:
+        raise ValueError(f"{path}: {len(tiles)} unique tiles, a level background can't use more than {BG_TILE_LIMIT}")
+    if len(rgb_palette) > BG_PALETTE_COLORS:
+        raise ValueError(f"{path}: {len(rgb_palette)} colors, a level background has one {BG_PALETTE_COLORS} color bank")
+
+    # Tileset as a strip one tile wide, so grit reads the tiles back in index order
+    tiles_img = Image.fromarray(tiles.reshape(-1, 8), mode='P')
+    tiles_img.putpalette(new_palette)
+    palette_img = Image.new('P', (8, 8))
+    palette_img.putpalette(new_palette)
+
+    def bmp(image):
+        # Save as BMP without color space information
+        data = io.BytesIO()
+        image.save(data, format='BMP', optimize=False)
+        return data.getvalue()
+
+    entry = f"// {summary}\n"
+    entry += f"#include <bn_regular_bg_tiles_items_{base_name}_tiles.h>\n"
+    entry += f"#include <bn_bg_palette_items_{base_name}_palette.h>\n"
+    entry += f"alignas(int) inline constexpr bn::regular_bg_map_cell {base_name}_cells[] = {{\n"
+    entry += "\n".join("    " + ", ".join(f"0x{c:04x}" for c in cells[i:i + 16]) + ","
+                       for i in range(0, len(cells), 16))
+    entry += f"\n}};\ninline constexpr bn::regular_bg_item {base_name}_bg(\n"
+    entry += f"    bn::regular_bg_tiles_items::{base_name}_tiles, bn::bg_palette_items::{base_name}_palette,\n"
+    entry += f"    bn::regular_bg_map_item({base_name}_cells[0], bn::size({columns}, {rows})));\n\n"
+
+    return {
+        "outputs": {
+            os.path.join(MAPS_OUT_DIR, f"{base_name}_tiles.bmp"): bmp(tiles_img),
+            os.path.join(MAPS_OUT_DIR, f"{base_name}_tiles.json"): b"""{
+    "type": "regular_bg_tiles",
+    "bpp_mode": "bpp_4"
+}
+""",
+            os.path.join(MAPS_OUT_DIR, f"{base_name}_palette.bmp"): bmp(palette_img),
+            os.path.join(MAPS_OUT_DIR, f"{base_name}_palette.json"): b"""{
+    "type": "bg_palette",
+    "bpp_mode": "bpp_4"
+}
+""",
+        },
+        "entry": entry,
+        "summary": summary,
+        "tiles": len(tiles),
+        "colors": len(rgb_palette),
+    }
+
+
+def dedupe_tiles(indexed):
+    """Splits an indexed image into 8x8 tiles and keeps one copy of each, a tile that is a mirror image of a kept one
+    reuses it through the map cell flip bits. Tile 0 is always the blank one, the streamer shows it outside the map.
+    Returns the unique tiles, the map cells in row order and how many cells needed a flip to match."""
+    import numpy as np
+
+    rows, columns = indexed.shape[0] // 8, indexed.shape[1] // 8
+    blocks = indexed.reshape(rows, 8, columns, 8).swapaxes(1, 2).reshape(-1, 8, 8)
+
+    tiles = [np.zeros((8, 8), dtype=np.uint8)]
+    known = {tiles[0].tobytes(): 0}
+    cells = []
+    flipped = 0
+
+    for block in blocks:
+        for flags, variant in ((0, block), (CELL_HFLIP, block[:, ::-1]), (CELL_VFLIP, block[::-1, :]),
+                               (CELL_HFLIP | CELL_VFLIP, block[::-1, ::-1])):
+            index = known.get(variant.tobytes())
+            if index is not None:
+                cells.append(index | flags)
+                flipped += flags != 0
+                break
+        else:
+            known[block.tobytes()] = len(tiles)
+            cells.append(len(tiles))
+            tiles.append(block)
+
+    return np.array(tiles), cells, flipped
+
+
+def background_budget(path):
+    """Tiles and palette colors of an indexed background bitmap once stored like a level background: split into
+    8x8 tiles with mirrored copies kept once."""
+    from PIL import Image
+    import numpy as np
+
+    image = Image.open(path)
+    if image.mode != "P":
+        raise ValueError(f"{path}: backgrounds must be indexed color bitmaps")
+    indexed = np.array(image)
+    tiles, _, _ = dedupe_tiles(indexed)
+    return len(tiles), int(indexed.max()) + 1
+
+
+def level_budget(level, image):
+    """Checks the backgrounds a level shows against the tile and palette budget they share, returns the report line.
+    image is the level's own converted background, None if it has none."""
+    backgrounds = [(image["path"], image["tiles"], image["colors"])] if image else []
+    if level.get("parallax_bg"):
+        backgrounds.append((level["parallax_bg"], *background_budget(level["parallax_bg"])))
+
+    total = sum(tiles for _, tiles, _ in backgrounds)
+    parts = " + ".join(f"{tiles} ({os.path.basename(path)})" for path, tiles, _ in backgrounds)
+    if total > BG_TILE_LIMIT:
+        raise ValueError(f"{level['name']}: its backgrounds need {parts} = {total} tiles, more than {BG_TILE_LIMIT}")
+    for path, _, colors in backgrounds:
+        if colors > BG_PALETTE_COLORS:
+            raise ValueError(f"{path}: {colors} colors, a background has one {BG_PALETTE_COLORS} color bank")
+    return (f"{parts or 0} = {total} of {BG_TILE_LIMIT} background tiles "
+            f"({total * BG_TILE_BYTES} of {BG_TILE_LIMIT * BG_TILE_BYTES} tile VRAM bytes)")
+
+
+def write_if_changed(path, data):
+    """Leaves files with the same contents untouched, so make doesn't see them as newer."""
+    try:
+        with open(path, "rb") as f:
+            if f.read() == data:
+                return False
+    except FileNotFoundError:
+        pass
+
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(data)
+    return True
+
+
+def input_hash(path, script_hash):
+    with open(path, "rb") as f:
+        return hashlib.sha256(script_hash + f.read()).hexdigest()
+
+
+def run_jobs(jobs):
+    """Runs (function, path) jobs across every core, returns their results in order."""
+    if len(jobs) <= 1:
+        return [function(path) for function, path in jobs]
+
+    with ProcessPoolExecutor() as pool:
+        futures = [pool.submit(function, path) for function, path in jobs]
+        return [future.result() for future in futures]
+
+
+def main():
+    with open(os.path.abspath(__file__), "rb") as f:
+        script_hash = hashlib.sha256(f.read()).digest()
+
+    try:
+        with open(CACHE_PATH, "r") as f:
+            cache = json.load(f)
+    except (FileNotFoundError, ValueError):
+        cache = {}
+
+    levels = [os.path.join(MAPS_JSON_DIR, name) for name in sorted(os.listdir(MAPS_JSON_DIR))
+              if name.endswith((".tmj", ".tmx"))]
+    images = [os.path.join(MAPS_RAW_DIR, name) for name in sorted(os.listdir(MAPS_RAW_DIR))]
+
+    # Maps also depend on the tilesets they use, any tileset change converts every map again
+    tileset_hash = script_hash
+    for name in sorted(os.listdir(TILESETS_DIR)):
+        if name.endswith(".tsx"):
+            tileset_hash = bytes.fromhex(input_hash(os.path.join(TILESETS_DIR, name), tileset_hash))
+    hashes = {path: input_hash(path, tileset_hash if path in levels else script_hash) for path in levels + images}
+
+    # Level entries are cached whole, images only need their outputs to still be there
+    def stale(path, function):
+        entry = cache.get(path)
+        if entry is None or entry["hash"] != hashes[path]:
+            return True
+        if function is convert_image:
+            return not all(os.path.exists(output) for output in entry["outputs"])
+        return False
+
+    jobs = [(convert_level, path) for path in levels if stale(path, convert_level)]
+    jobs += [(convert_image, path) for path in images if stale(path, convert_image)]
+
+    try:
+        results = run_jobs(jobs)
+    except ValueError as error:
+        print(f"error: {error}", file=sys.stderr)
+        return 1
+
+    new_cache = {}
+    for (function, path), result in zip(jobs, results):
+        if function is convert_image:
+            for output, data in result["outputs"].items():
+                written = write_if_changed(output, data)
+                print(f"{output} {'written' if written else 'unchanged'}")
+
+            # Outputs the last conversion had and this one doesn't would still be picked up by grit
+            for output in cache.get(path, {}).get("outputs", []):
+                if output not in result["outputs"] and os.path.exists(output):
+                    os.remove(output)
+                    print(f"{output} removed")
+            result = dict(result, outputs=list(result["outputs"]))
+        new_cache[path] = dict(result, hash=hashes[path])
+
+    for path in levels + images:
+        if path not in new_cache:
+            new_cache[path] = cache[path]
+
+    # Budget report, every run so it stays in sight: each background, then the total of every level's backgrounds
+    for path in images:
+        print(f"{path}: {new_cache[path]['summary']}")
+    for path in levels:
+        level = new_cache[path]
+        image = next((dict(new_cache[image], path=image) for image in images
+                      if os.path.splitext(os.path.basename(image))[0] == level["name"]), None)
+        try:
+            print(f"{path}: {level_budget(level, image)}")
+        except ValueError as error:
+            print(f"error: {error}", file=sys.stderr)
+            return 1
+
+    final = """#pragma once
+
+#include "level_asset.h"
+
+#ifndef BLINX_HOST
+#include <bn_regular_bg_item.h>
+"""
+    for include in sorted({include for path in levels for include in new_cache[path].get("includes", [])}):
+        final += f"#include <{include}>\n"
+    final += "\n"
+    for path in images:
+        final += new_cache[path]["entry"]
+    final += "#endif\n\n"
+
+    names = []
+    for path in levels:
+        names.append(new_cache[path]["name"])
+        final += new_cache[path]["entry"]
+
+    final += "// Every level in play order\n"
+    final += "inline constexpr const level_asset *level_assets[] = {" + ", ".join(f"&{n}" for n in names) + "};\n"
+    final += "constexpr int LEVEL_COUNT = sizeof(level_assets) / sizeof(level_assets[0]);\n"
+
+    written = write_if_changed(MAPS_HEADER, final.encode())
+    print(f"{MAPS_HEADER} {'written' if written else 'unchanged'}, "
+          f"{len(jobs)} of {len(levels) + len(images)} map inputs converted")
+
+    os.makedirs(os.path.dirname(CACHE_PATH), exist_ok=True)
+    with open(CACHE_PATH, "w") as f:
+        json.dump(new_cache, f, indent=1)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,127 @@
+#include <bn_display.h>
+#include <bn_regular_bg_tiles_ptr.h>
+#include <bn_bg_palette_ptr.h>
+#include <bn_span.h>
+
+#include "bg_streamer.h"
+#include "layers.h"
+
+namespace
+{
+    // The ring map has one cell per 8x8 pixel tile
+    constexpr int CELL_SHIFT = 3;
+
+    bn::regular_bg_map_ptr allocate_ring(const bn::regular_bg_item &item, int ring_size)
+    {
+        return bn::regular_bg_map_ptr::allocate(bn::size(ring_size, ring_size), item.tiles_item().create_tiles(),
+                                                item.palette_item().create_palette());
+    }
+}
+
+bg_streamer::bg_streamer(const bn::regular_bg_item &item, const bn::camera_ptr &camera)
+    : _source(item.map_item()),
+      _map(allocate_ring(item, RING_SIZE)),
+      _bg(bn::regular_bg_ptr::create(RING_SIZE * 8 / 2, RING_SIZE * 8 / 2, _map)),
+      _camera(camera)
+{
+    // Centered at half the ring size, so with the camera attached the ring's top left corner is level pixel (0, 0)
+    // and the hardware wrap maps map column c to ring column c % 32
+    _bg.set_camera(_camera);
+    _bg.set_priority(LEVEL_BG_PRIORITY);
+    _left = _target_left();
+    _top = _target_top();
+    _load_all();
+}
+
+int bg_streamer::_target_left() const
+{
+    return (_camera.x().floor_integer() - bn::display::width() / 2) >> CELL_SHIFT;
+}
+
+int bg_streamer::_target_top() const
+{
+    int visible_rows = (bn::display::height() >> CELL_SHIFT) + 1;
+    return ((_camera.y().floor_integer() - bn::display::height() / 2) >> CELL_SHIFT) - (RING_SIZE - visible_rows) / 2;
+}
+
+void bg_streamer::update()
+{
+    int target_left = _target_left();
+    int target_top = _target_top();
+
+    // Teleports and level starts refill the whole ring at once
+    if (target_left - _left >= RING_SIZE || _left - target_left >= RING_SIZE ||
+        target_top - _top >= RING_SIZE || _top - target_top >= RING_SIZE)
+    {
+        _left = target_left;
+        _top = target_top;
+        _load_all();
+        return;
+    }
+
+    // The column or row that scrolls in takes the ring slot of the one that scrolls out
+    for (int budget = LINES_PER_FRAME; budget > 0 && _left != target_left; --budget)
+    {
+        if (_left < target_left)
+        {
+            _load_column(_left + RING_SIZE);
+            ++_left;
+        }
+        else
+        {
+            --_left;
+            _load_column(_left);
+        }
+    }
+
+    for (int budget = LINES_PER_FRAME; budget > 0 && _top != target_top; --budget)
+    {
+        if (_top < target_top)
+        {
+            _load_row(_top + RING_SIZE);
+            ++_top;
+        }
+        else
+        {
+            --_top;
+            _load_row(_top);
+        }
+    }
+}
+
+void bg_streamer::_load_all()
+{
+    for (int column = _left; column < _left + RING_SIZE; ++column)
+    {
+        _load_column(column);
+    }
+}
+
+void bg_streamer::_load_column(int column)
+{
+    bn::span<bn::regular_bg_map_cell> ring = *_map.vram();
+    bn::size dimensions = _source.dimensions();
+    bool inside = column >= 0 && column < dimensions.width();
+    int slot = column & (RING_SIZE - 1);
+
+    for (int row = _top; row < _top + RING_SIZE; ++row)
+    {
+        // Outside the map shows cell 0, the padding color
+        bool cell_inside = inside && row >= 0 && row < dimensions.height();
+        ring[((row & (RING_SIZE - 1)) * RING_SIZE) + slot] = cell_inside ? _source.cell(column, row) : 0;
+    }
+}
+
+void bg_streamer::_load_row(int row)
+{
+    bn::span<bn::regular_bg_map_cell> ring = *_map.vram();
+    bn::size dimensions = _source.dimensions();
+    bool inside = row >= 0 && row < dimensions.height();
+    int offset = (row & (RING_SIZE - 1)) * RING_SIZE;
+
+    for (int column = _left; column < _left + RING_SIZE; ++column)
+    {
+        bool cell_inside = inside && column >= 0 && column < dimensions.width();
+        ring[offset + (column & (RING_SIZE - 1))] = cell_inside ? _source.cell(column, row) : 0;
+    }
+}
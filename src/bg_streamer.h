@@ -0,0 +1,39 @@
+#pragma once
+
+#include <bn_camera_ptr.h>
+#include <bn_regular_bg_item.h>
+#include <bn_regular_bg_map_item.h>
+#include <bn_regular_bg_map_ptr.h>
+#include <bn_regular_bg_ptr.h>
+
+// Shows a level background of any size through a single 32x32 cell map in VRAM.
+// The full map stays in ROM; the VRAM map is used as a ring, and only the columns and rows the camera is about to
+// reveal are copied in, a few per frame, so level size is limited by ROM instead of VRAM.
+class bg_streamer
+{
+public:
+    // Map cell (0, 0) is placed at level pixel (0, 0)
+    bg_streamer(const bn::regular_bg_item &item, const bn::camera_ptr &camera);
+
+    // Call once per frame after moving the camera
+    void update();
+
+private:
+    static constexpr int RING_SIZE = 32;     // cells per side of the VRAM map
+    static constexpr int LINES_PER_FRAME = 2; // columns and rows copied per frame at most, each way
+
+    bn::regular_bg_map_item _source;
+    bn::regular_bg_map_ptr _map;
+    bn::regular_bg_ptr _bg;
+    bn::camera_ptr _camera;
+    int _left = 0; // first map column held in the ring
+    int _top = 0;  // first map row held in the ring
+
+    // Window of the map the camera needs, spare rows split above and below, the spare column on the right
+    int _target_left() const;
+    int _target_top() const;
+
+    void _load_all();
+    void _load_column(int column);
+    void _load_row(int row);
+};
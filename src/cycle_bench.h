@@ -0,0 +1,50 @@
+#pragma once
+
+#include <bn_core.h>
+#include <bn_log.h>
+
+#include "cycle_timer.h"
+#include "entities.h"
+#include "input_script.h"
+#include "level_loader.h"
+#include "maps.h"
+
+// Cycles in one frame at 59.73 Hz
+constexpr int CYCLES_PER_FRAME = 280896;
+
+// Steps the scripted demo01 run through world::update and logs average and worst cycles per frame.
+// Rendering is left out: only the simulation is timed, one world::update per vblank.
+inline void run_cycle_bench(int frames)
+{
+    level_loader loader;
+    loader.start(demo01);
+    while (!loader.update())
+    {
+    }
+
+    world game(loader.level());
+    unsigned overhead = cycle_timer::overhead();
+    unsigned total = 0;
+    unsigned worst = 0;
+
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        int input = scripted_input(demo01_script, script_size(demo01_script), frame);
+
+        cycle_timer::start();
+        game.update(input);
+        unsigned cycles = cycle_timer::stop() - overhead;
+
+        total += cycles;
+        if (cycles > worst)
+            worst = cycles;
+
+        bn::core::update();
+    }
+
+    unsigned average = total / unsigned(frames);
+    BN_LOG("cycle bench: ", frames, " frames, ", CLONE_COUNT, " clone slots");
+    BN_LOG("cycles per frame: ", average, " average, ", worst, " worst");
+    BN_LOG("frame budget used: ", (average * 1000) / CYCLES_PER_FRAME, " permille average, ",
+           (worst * 1000) / CYCLES_PER_FRAME, " permille worst");
+}
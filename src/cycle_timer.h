@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+// Cycle counter built from hardware timers 0 and 1 cascaded, one tick per CPU cycle.
+// Only used by benchmark and profiling builds: timer 0 also drives Direct Sound, so audio breaks while it runs.
+#if !defined(BLINX_CYCLE_BENCH) && !defined(BLINX_PROFILE)
+    #error "cycle_timer.h takes over timers 0 and 1, include it from CYCLE_BENCH=1 or PROFILE=1 builds only"
+#endif
+
+namespace cycle_timer
+{
+    inline volatile uint16_t &timer_register(int offset)
+    {
+        return *reinterpret_cast<volatile uint16_t *>(0x04000100 + offset);
+    }
+
+    constexpr uint16_t enable = 0x0080;
+    constexpr uint16_t cascade = 0x0004;
+
+    inline void start()
+    {
+        timer_register(2) = 0;
+        timer_register(6) = 0;
+        timer_register(0) = 0;
+        timer_register(4) = 0;
+
+        // Timer 1 counts timer 0 overflows, so it has to be running first
+        timer_register(6) = enable | cascade;
+        timer_register(2) = enable;
+    }
+
+    // Cycles since start(), up to 2^32
+    inline unsigned stop()
+    {
+        timer_register(2) = 0;
+        return timer_register(0) | (unsigned(timer_register(4)) << 16);
+    }
+
+    // Starts counting without a matching stop(), read it with now()
+    inline void run()
+    {
+        start();
+    }
+
+    // Cycles since start() or run() while the counter is running, differences wrap correctly
+    inline unsigned now()
+    {
+        unsigned high = timer_register(4);
+        unsigned low = timer_register(0);
+        unsigned checked_high = timer_register(4);
+
+        // Timer 0 overflowed between the reads, the low half is from before it
+        if (checked_high != high)
+            low = timer_register(0);
+
+        return low | (checked_high << 16);
+    }
+
+    // Cycles an empty start()/stop() pair measures, subtracted from every sample
+    inline unsigned overhead()
+    {
+        start();
+        return stop();
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "physics.h"
+#include "input_log.h"
+#include "slot_pool.h"
+#include "movers.h"
+
+// Player controller, its physics state lives in the entity store under PLAYER_ID
+struct player_ptr
+{
+    // Feeds this frame's keypad input to the player entity
+    void update(int input);
+};
+
+// Clone controller: records and replays input, its physics state lives in the entity store under its slot
+struct clone_ptr
+{
+    int init_x, init_y;
+    int loop_frames; // length of the recorded loop
+    int h = 0;       // frame within the current recording or loop
+    bool recording = true;
+
+    input_log history;
+
+    // Check if this clone is in recording mode (ghost mode)
+    bool is_recording() const { return recording; }
+
+    clone_ptr(int init_x_, int init_y_, int loop_frames_)
+        : init_x(init_x_), init_y(init_y_), loop_frames(loop_frames_)
+    {
+    }
+
+    // Check if respawn position would overlap with other entities
+    bool check_respawn_collision(int my_slot) const;
+
+    // Ends ghost mode, the loop replays whatever was recorded
+    void stop_recording();
+
+    // Records input while in ghost mode, returns true if clone should be destroyed
+    bool update(int my_slot, int input);
+};
+
+// Clones keep their slot for life, so slot indices double as their entity ids
+using clone_pool = slot_pool<clone_ptr, CLONE_COUNT>;
+
+// Everything the simulation owns: stepped once per frame from an input code, no rendering
+struct world
+{
+    explicit world(const level_ptr &level_);
+
+    world(const world &) = delete;
+    world &operator=(const world &) = delete;
+
+    void update(int input);
+
+    // Size of the byte image save_state() writes: entity store, broadphase order, clone controllers, mover
+    // scripts and frame
+    static constexpr int state_size()
+    {
+        return int(sizeof(entity_store) + sizeof(entity_sweep)) + clone_pool::state_size() +
+               mover_vm::state_size() + int(sizeof(int));
+    }
+
+    // Everything the next update() depends on, so restoring a saved image replays bit for bit
+    void save_state(uint8_t *out) const;
+    void load_state(const uint8_t *in);
+
+    // Hash of the observable simulation state: frame, live entities and clone timing.
+    // Caches, broadphase order and stale bytes of dead slots are left out, so it only changes when behavior
+    // does and matches between the ROM and host builds.
+    [[nodiscard]] uint32_t hash() const;
+
+    // Puts the player in the level's start tile, standing still
+    void spawn_player();
+
+    // Whether the player or a clone is on a hazard tile or touching a hazardous mover
+    [[nodiscard]] bool hurt(int id) const;
+
+    const level_ptr &level;
+    player_ptr player;
+    clone_pool clones;
+    mover_vm movers;
+    int frame = 0;
+};
@@ -0,0 +1,205 @@
+#include <bn_display.h>
+
+#include "bn_sprite_items_spr_blinx.h"
+#include "bn_sprite_items_spr_mover.h"
+#include "bn_sprite_palette_items_pal_ghost.h"
+
+#include "entity_sprites.h"
+#include "layers.h"
+
+namespace
+{
+    // Run of frames in spr_blinx a pose plays, looping, each frame shown for frame_ticks commits
+    struct pose_animation
+    {
+        uint8_t first;
+        uint8_t count;
+        uint8_t frame_ticks;
+    };
+
+    constexpr pose_animation POSE_ANIMATIONS[POSE_COUNT] = {
+        {0, 2, 32}, // idle
+        {2, 4, 6},  // run
+        {6, 1, 1},  // jump
+        {7, 1, 1},  // fall
+        {8, 2, 12}, // push
+    };
+
+    // Frame of spr_mover a mover shows, by whether it hurts
+    int mover_frame(const entity_store &entities, int id)
+    {
+        return (entities.flags[id] & ENTITY_HAZARD) ? 1 : 0;
+    }
+
+    // Whether a point this far from the screen center is at most margin pixels outside the screen
+    bool in_view(int dx, int dy, int margin)
+    {
+        int half_width = bn::display::width() / 2 + margin;
+        int half_height = bn::display::height() / 2 + margin;
+        return dx > -half_width && dx < half_width && dy > -half_height && dy < half_height;
+    }
+
+    entity_pose pose_of(const entity_store &entities, int id, fixed last_x)
+    {
+        if (!entities.on_ground(id))
+            return entities.velocity_y[id] < 0 ? POSE_JUMP : POSE_FALL;
+
+        if (entities.walk_x[id] == 0)
+            return POSE_IDLE;
+
+        // Walking but held back, by a wall or by something too heavy to shove at full speed
+        fixed moved = entities.x[id] > last_x ? entities.x[id] - last_x : last_x - entities.x[id];
+        fixed asked = entities.walk_x[id] > 0 ? fixed(entities.walk_x[id]) : fixed(-entities.walk_x[id]);
+        return moved < asked ? POSE_PUSH : POSE_RUN;
+    }
+}
+
+entity_sprites::entity_sprites(const bn::camera_ptr &camera)
+    : _camera(camera),
+      _frames(bn::sprite_items::spr_blinx),
+      _mover_frames(bn::sprite_items::spr_mover),
+      _palette(bn::sprite_items::spr_blinx.palette_item().create_palette()),
+      _ghost_palette(bn::sprite_palette_items::pal_ghost.create_palette()),
+      _mover_palette(bn::sprite_items::spr_mover.palette_item().create_palette())
+{
+}
+
+void entity_sprites::_show(int id)
+{
+    const entity_store &entities = physics_manager::instance().entities;
+    entity_sprite &entry = _sprites[id];
+    if (id >= FIRST_MOVER_ID)
+    {
+        entry.frame = uint8_t(mover_frame(entities, id));
+        entry.sprite = bn::sprite_ptr::create(entities.x[id], entities.y[id],
+                                              bn::sprite_items::spr_mover.shape_size(),
+                                              _mover_frames.acquire(entry.frame), _mover_palette);
+        entry.sprite->set_bg_priority(ENTITY_SPRITE_PRIORITY);
+        entry.sprite->set_camera(_camera);
+        return;
+    }
+
+    entry.pose = pose_of(entities, id, entry.last_x);
+    entry.step = 0;
+    entry.ticks = 0;
+    entry.frame = POSE_ANIMATIONS[entry.pose].first;
+
+    entry.sprite = bn::sprite_ptr::create(entities.x[id], entities.y[id], bn::sprite_items::spr_blinx.shape_size(),
+                                          _frames.acquire(entry.frame), _palette);
+    entry.sprite->set_bg_priority(ENTITY_SPRITE_PRIORITY);
+    entry.sprite->set_camera(_camera);
+    if (id != PLAYER_ID)
+    {
+        entry.sprite->set_blending_enabled(true);
+    }
+}
+
+void entity_sprites::_hide(int id)
+{
+    entity_sprite &entry = _sprites[id];
+    if (entry.sprite)
+    {
+        entry.sprite.reset();
+        (id >= FIRST_MOVER_ID ? _mover_frames : _frames).release(entry.frame);
+    }
+}
+
+void entity_sprites::_animate(int id)
+{
+    const entity_store &entities = physics_manager::instance().entities;
+    entity_sprite &entry = _sprites[id];
+
+    entity_pose pose = pose_of(entities, id, entry.last_x);
+    entry.last_x = entities.x[id];
+    const pose_animation &animation = POSE_ANIMATIONS[pose];
+    if (pose != entry.pose)
+    {
+        entry.pose = pose;
+        entry.step = 0;
+        entry.ticks = 0;
+    }
+    else if (++entry.ticks == animation.frame_ticks)
+    {
+        entry.ticks = 0;
+        if (++entry.step == animation.count)
+            entry.step = 0;
+    }
+
+    // Tiles only change hands when the frame does, the new frame is uploaded if no other sprite shows it yet
+    int frame = animation.first + entry.step;
+    if (frame != entry.frame)
+    {
+        entry.sprite->set_tiles(_frames.acquire(frame));
+        _frames.release(entry.frame);
+        entry.frame = uint8_t(frame);
+    }
+
+    const bn::sprite_palette_ptr &palette = entities.ghost(id) ? _ghost_palette : _palette;
+    if (entry.sprite->palette() != palette)
+    {
+        entry.sprite->set_palette(palette);
+    }
+
+    if (entities.walk_x[id] != 0)
+    {
+        entry.sprite->set_horizontal_flip(entities.walk_x[id] < 0);
+    }
+}
+
+void entity_sprites::_animate_mover(int id)
+{
+    entity_sprite &entry = _sprites[id];
+    int frame = mover_frame(physics_manager::instance().entities, id);
+    if (frame != entry.frame)
+    {
+        entry.sprite->set_tiles(_mover_frames.acquire(frame));
+        _mover_frames.release(entry.frame);
+        entry.frame = uint8_t(frame);
+    }
+}
+
+void entity_sprites::commit()
+{
+    const entity_store &entities = physics_manager::instance().entities;
+    int camera_x = _camera.x().integer();
+    int camera_y = _camera.y().integer();
+
+    for (int id = 0; id < ENTITY_COUNT; ++id)
+    {
+        entity_sprite &entry = _sprites[id];
+        if (!entities.alive(id))
+        {
+            _hide(id);
+            continue;
+        }
+
+        if (!in_view(entities.x[id].integer() - camera_x, entities.y[id].integer() - camera_y,
+                     entry.sprite ? HIDE_MARGIN : SHOW_MARGIN))
+        {
+            // Still tracked, so an entity walking back into view doesn't start out pushing
+            _hide(id);
+            entry.last_x = entities.x[id];
+            continue;
+        }
+
+        if (!entry.sprite)
+        {
+            _show(id);
+        }
+        if (id >= FIRST_MOVER_ID)
+        {
+            _animate_mover(id);
+        }
+        else
+        {
+            _animate(id);
+        }
+
+        // Moving a sprite marks its OAM entry for an update, entities standing still don't need one
+        bn::fixed_point position(entities.x[id], entities.y[id]);
+        if (entry.sprite->position() != position)
+        {
+            entry.sprite->set_position(position);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <bn_camera_ptr.h>
+#include <bn_optional.h>
+#include <bn_sprite_palette_ptr.h>
+#include <bn_sprite_ptr.h>
+
+#include "physics.h"
+#include "sprite_frames.h"
+
+// What an entity is doing, each pose plays its own run of frames from the sprite sheet
+enum entity_pose : uint8_t
+{
+    POSE_IDLE,
+    POSE_RUN,
+    POSE_JUMP,
+    POSE_FALL,
+    POSE_PUSH,
+    POSE_COUNT
+};
+
+// Sprites of the player, clones and movers, kept apart from the simulation and committed from the entity store in one pass
+// per frame, after physics and the camera are done with it.
+// Only entities near the screen have a sprite: the rest give theirs back to Butano, so sprite handles and OAM work
+// follow what the camera sees instead of how many clones there are or how big the level is.
+// Every sprite showing the same frame shares its tiles, and recording clones swap to the ghost palette.
+// Movers come from their own sheet: one frame while harmless and one while they hurt.
+class entity_sprites
+{
+public:
+    explicit entity_sprites(const bn::camera_ptr &camera);
+
+    // Creates, moves, animates and releases sprites to match the entity store and the camera
+    void commit();
+
+private:
+    // Pixels past the screen edge an entity's center may be at to get a sprite, and to keep it.
+    // Keeping reaches further, so an entity pacing along the edge doesn't get a new sprite every other frame.
+    static constexpr int SHOW_MARGIN = ENTITY_SIZE;
+    static constexpr int HIDE_MARGIN = ENTITY_SIZE * 2;
+
+    struct entity_sprite
+    {
+        bn::optional<bn::sprite_ptr> sprite;
+        fixed last_x;       // where the entity was at the last commit, walking without getting there is pushing
+        entity_pose pose = POSE_IDLE;
+        uint8_t step = 0;   // frame within the pose's animation
+        uint8_t ticks = 0;  // commits the current frame has been shown for
+        uint8_t frame = 0;  // sheet frame the sprite's tiles are from
+    };
+
+    bn::camera_ptr _camera;
+    sprite_frames _frames;
+    sprite_frames _mover_frames;
+    bn::sprite_palette_ptr _palette;
+    bn::sprite_palette_ptr _ghost_palette;
+    bn::sprite_palette_ptr _mover_palette;
+    entity_sprite _sprites[ENTITY_COUNT]; // by entity id
+
+    void _show(int id);
+    void _hide(int id);
+    void _animate(int id);
+    void _animate_mover(int id);
+};
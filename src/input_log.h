@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+#include <bn_assert.h>
+
+#include "level.h"
+
+// Input recording for clones, two frames per byte: an input code (LEFT|RIGHT|JUMP|DASH) fits in a nibble.
+// The log always has room for MAX_LOOP_FRAMES frames, so a level's loop_frames is recorded in full however often
+// the input changes, in an eighth of the memory of an int per frame.
+class input_log
+{
+public:
+    static constexpr int capacity = MAX_LOOP_FRAMES / 2; // bytes
+
+    // Appends one frame
+    void record(int code)
+    {
+        BN_ASSERT(_frames < MAX_LOOP_FRAMES, "Input log is full");
+
+        _codes[_frames >> 1] |= uint8_t(code << ((_frames & 1) * 4));
+        ++_frames;
+    }
+
+    // Number of frames recorded so far
+    int frames() const { return _frames; }
+
+    // Restarts playback from the first recorded frame
+    void rewind()
+    {
+        _cursor = 0;
+    }
+
+    // Returns the next recorded frame, wrapping back to the start after the last one
+    int next()
+    {
+        int code = (_codes[_cursor >> 1] >> ((_cursor & 1) * 4)) & 15;
+        if (++_cursor == _frames)
+            _cursor = 0;
+        return code;
+    }
+
+private:
+    uint8_t _codes[capacity] = {};
+    int16_t _frames = 0;
+    int16_t _cursor = 0;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "physics.h"
+
+// One stretch of held input in a scripted run
+struct input_run
+{
+    int frames;
+    int code;
+};
+
+// Returns the input code for a frame of a script that loops until the run ends
+inline int scripted_input(const input_run *script, int script_size, int frame)
+{
+    int length = 0;
+    for (int i = 0; i < script_size; ++i)
+        length += script[i].frames;
+
+    frame %= length;
+    for (int i = 0; i < script_size; ++i)
+    {
+        if (frame < script[i].frames)
+            return script[i].code;
+        frame -= script[i].frames;
+    }
+    return 0;
+}
+
+template<typename Type, int Size>
+constexpr int script_size(const Type (&)[Size])
+{
+    return Size;
+}
+
+// Scripted run through demo01, shared by the host benchmark and the on-device cycle benchmark
+inline const input_run demo01_script[] = {
+    {60, RIGHT}, {1, RIGHT | JUMP}, {30, RIGHT}, {1, SPAWN}, {45, LEFT}, {1, JUMP},
+    {20, 0}, {40, RIGHT | DASH}, {1, RIGHT | JUMP}, {25, RIGHT}, {1, SPAWN}, {60, LEFT | DASH},
+    {1, LEFT | JUMP}, {30, LEFT}, {1, SPAWN}, {80, RIGHT}, {1, JUMP}, {40, 0},
+};
@@ -0,0 +1,9 @@
+#pragma once
+
+// Hardware priorities of what the game draws, lower is in front. A sprite is drawn in front of every background
+// whose priority is the same as its own or higher, so from back to front: the parallax background, the level
+// background, entity sprites and the profiler's text.
+constexpr int PARALLAX_PRIORITY = 3;
+constexpr int LEVEL_BG_PRIORITY = 2;
+constexpr int ENTITY_SPRITE_PRIORITY = LEVEL_BG_PRIORITY;
+constexpr int OVERLAY_SPRITE_PRIORITY = 0;
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+
+namespace bn
+{
+    class regular_bg_item;
+}
+
+// Collision layers store 4 bits per tile, two tiles per byte with the even tile in the low nibble.
+// Rows are padded to 1 << stride_shift tiles so a lookup is a shift and a mask, never a multiply.
+constexpr int COLLISION_BITS = 4;
+constexpr int COLLISION_MASK = (1 << COLLISION_BITS) - 1;
+
+// Tile attribute flags, a level has one byte of them per collision value (see level_ptr::tile_attributes)
+const int TILE_SOLID = 1;
+const int TILE_ONE_WAY = 2;
+const int TILE_HAZARD = 4;
+const int TILE_ICE = 8;
+const int TILE_CONVEYOR = 16;
+const int TILE_CLONE_BLOCKER = 32;
+
+// Longest clone loop a level may ask for, clone input logs always have room for this many frames
+constexpr int MAX_LOOP_FRAMES = 512;
+
+// Movement tuning a level is played with, each one a physics_config instantiation in physics.h
+enum physics_preset : uint8_t
+{
+    PHYSICS_DEFAULT,
+    PHYSICS_LOW_GRAVITY,
+    PHYSICS_PRESET_COUNT
+};
+
+// Attributes of levels without a tileset of their own: every collision value is solid
+inline constexpr uint8_t SOLID_TILE_ATTRIBUTES[COLLISION_MASK + 1] = {
+    0, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID,
+    TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID, TILE_SOLID,
+};
+
+// Area in level pixels
+struct level_rect
+{
+    int16_t x, y;
+    int16_t width, height;
+};
+
+// Point in level pixels
+struct level_point
+{
+    int16_t x, y;
+};
+
+// Trigger area placed in Tiled, event is its "event" property or else its object id
+struct level_trigger
+{
+    level_rect area;
+    int16_t event;
+};
+
+// Object moved by a bytecode script (see movers.h), scripts are shared between movers that run the same one
+struct level_mover
+{
+    level_point position; // center of its box
+    uint16_t script;      // offset of its script in level_ptr::mover_code
+};
+
+// Horizontal band of the parallax background, from its top screen line down to the next band's top.
+// Scroll factors are in 1/4096ths of the camera's movement: 4096 moves with the level, 0 stays put.
+struct parallax_band
+{
+    int16_t top;
+    int16_t factor; // factor of the band's top line
+    int16_t slope;  // added to the factor for every line further down, for floors that speed up toward the viewer
+};
+
+// Read-only table of level objects in ROM, empty tables have no items
+template<typename Type>
+struct level_table
+{
+    const Type *items = nullptr;
+    int count = 0;
+
+    constexpr const Type *begin() const { return items; }
+    constexpr const Type *end() const { return items + count; }
+};
+
+// Level structure
+struct level_ptr
+{
+    const bn::regular_bg_item *bg_item;
+    const uint8_t *collisions;
+    int stride_shift;
+    int size_x;
+    int size_y;
+    int init_x;
+    int init_y;
+    int loop_frames; // frames a clone records before it starts replaying, 1 to MAX_LOOP_FRAMES
+
+    const uint8_t *tile_attributes = SOLID_TILE_ATTRIBUTES; // TILE_* flags by collision value, COLLISION_MASK + 1 of them
+    physics_preset physics = PHYSICS_DEFAULT;
+
+    // Objects from the map's object layers, by their Tiled class
+    level_table<level_point> spawns = {}; // the first one is the player start
+    level_table<level_rect> goals = {};
+    level_table<level_trigger> triggers = {};
+    level_table<level_mover> movers = {};
+    const uint8_t *mover_code = nullptr; // every mover script of the level, back to back
+
+    // Background drawn behind the level and scrolled by bands, none if null
+    level_table<parallax_band> parallax = {};
+    const bn::regular_bg_item *parallax_bg = nullptr;
+};
+
+// Collision value of an in-bounds tile
+inline int collision_at(const level_ptr &level, int tile_x, int tile_y)
+{
+    int index = (tile_y << level.stride_shift) | tile_x;
+    return (level.collisions[index >> 1] >> ((index & 1) * COLLISION_BITS)) & COLLISION_MASK;
+}
+
+// TILE_* flags of an in-bounds tile, one table load whatever the tile type
+inline int attributes_at(const level_ptr &level, int tile_x, int tile_y)
+{
+    return level.tile_attributes[collision_at(level, tile_x, tile_y)];
+}
+
+// Level backgrounds are put together in maps.h from a deduplicated tileset and map cells.
+// Host builds have no converted graphics, so levels carry no background there.
+#ifdef BLINX_HOST
+    #define LEVEL_BG_ITEM(name) nullptr
+    #define LEVEL_PARALLAX_BG(name) nullptr
+#else
+    #define LEVEL_BG_ITEM(name) &name##_bg
+    #define LEVEL_PARALLAX_BG(name) &bn::regular_bg_items::name
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "level.h"
+
+// A level as it sits in ROM, written by scripts/convert-tiles.py as a constexpr descriptor.
+// Everything but the collision layer is ready to use; the layer is an LZ77 stream (see lz77.h) of the packed
+// collision layer (see level.h), see level_loader.h to decompress it.
+struct level_asset
+{
+    level_ptr level; // collisions is null until loaded
+    const uint8_t *collision_stream;
+    int collision_stream_size;
+};
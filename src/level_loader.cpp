@@ -0,0 +1,40 @@
+#include <bn_assert.h>
+#include <bn_common.h>
+
+#include "level_loader.h"
+
+namespace
+{
+    BN_DATA_EWRAM uint8_t shared_arena[LEVEL_ARENA_SIZE];
+}
+
+level_loader::level_loader()
+    : level_loader(shared_arena, LEVEL_ARENA_SIZE)
+{
+}
+
+level_loader::level_loader(uint8_t *arena, int arena_size)
+    : _arena(arena), _arena_size(arena_size)
+{
+}
+
+int level_loader::arena_bytes(const level_asset &asset)
+{
+    return lz77_decoder::decompressed_size(asset.collision_stream);
+}
+
+void level_loader::start(const level_asset &asset)
+{
+    BN_ASSERT(asset.collision_stream_size > lz77_decoder::header_size && asset.collision_stream[0] == 0x10,
+              "Not an LZ77 collision stream");
+    BN_ASSERT(arena_bytes(asset) <= _arena_size, "Level does not fit in the arena: ", arena_bytes(asset));
+
+    _level = asset.level;
+    _level.collisions = _arena;
+    _decoder.start(asset.collision_stream, _arena);
+}
+
+bool level_loader::update(int budget)
+{
+    return _decoder.run(budget);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bn_assert.h>
+
+#include "level_asset.h"
+#include "lz77.h"
+
+// Bytes decompressed per update() call by default, a fraction of a frame even from ROM
+constexpr int LEVEL_LOAD_BYTES_PER_FRAME = 4096;
+
+// Largest packed collision layer a level can have, the size of the shared EWRAM arena
+constexpr int LEVEL_ARENA_SIZE = 64 * 1024;
+
+// Decompresses a level's collision layer into a RAM arena, a slice per update() so a load never stalls a frame.
+// level() points into the arena, so starting another load invalidates the level that was there.
+class level_loader
+{
+public:
+    // Loads into the shared EWRAM arena, only one such loader should be alive
+    level_loader();
+
+    level_loader(uint8_t *arena, int arena_size);
+
+    level_loader(const level_loader &) = delete;
+    level_loader &operator=(const level_loader &) = delete;
+
+    // Arena bytes the level needs
+    static int arena_bytes(const level_asset &asset);
+
+    void start(const level_asset &asset);
+
+    // Decompresses up to budget more bytes, returns true once level() is ready
+    bool update(int budget = LEVEL_LOAD_BYTES_PER_FRAME);
+
+    [[nodiscard]] bool done() const { return _decoder.done(); }
+
+    [[nodiscard]] const level_ptr &level() const
+    {
+        BN_ASSERT(done(), "Level is still loading");
+        return _level;
+    }
+
+private:
+    uint8_t *_arena;
+    int _arena_size;
+    lz77_decoder _decoder;
+    level_ptr _level = {};
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+
+// Incremental decoder for the LZ77 layout the GBA BIOS uses (LZ77UnCompWram, type 0x10), so a large stream
+// can be decoded a slice per frame instead of in one call.
+// Header: 0x10, then the decompressed size in 24 bits. After that, groups of eight blocks each led by a flag byte
+// read from the top bit down: 0 is one literal byte, 1 is a two byte back reference holding length - 3 in the top
+// nibble and distance - 1 in the remaining 12 bits.
+class lz77_decoder
+{
+public:
+    static constexpr int header_size = 4;
+
+    static int decompressed_size(const uint8_t *stream)
+    {
+        return stream[1] | (stream[2] << 8) | (stream[3] << 16);
+    }
+
+    void start(const uint8_t *stream, uint8_t *destination)
+    {
+        _source = stream + header_size;
+        _destination = destination;
+        _size = decompressed_size(stream);
+        _written = 0;
+        _flags = 0;
+        _flag_bits = 0;
+    }
+
+    [[nodiscard]] bool done() const { return _written >= _size; }
+
+    // Decodes at least budget bytes unless the stream ends first, returns true once all of it is decoded
+    bool run(int budget)
+    {
+        int stop = _written + budget;
+        if (stop > _size)
+            stop = _size;
+
+        while (_written < stop)
+        {
+            if (_flag_bits == 0)
+            {
+                _flags = *_source++;
+                _flag_bits = 8;
+            }
+
+            bool reference = _flags & 0x80;
+            _flags = uint8_t(_flags << 1);
+            --_flag_bits;
+
+            if (!reference)
+            {
+                _destination[_written++] = *_source++;
+                continue;
+            }
+
+            int length = (_source[0] >> 4) + 3;
+            int distance = (((_source[0] & 0x0f) << 8) | _source[1]) + 1;
+            _source += 2;
+
+            if (length > _size - _written)
+                length = _size - _written;
+
+            // Byte by byte on purpose, references may overlap the bytes they produce
+            const uint8_t *from = _destination + _written - distance;
+            for (int i = 0; i < length; ++i)
+            {
+                _destination[_written + i] = from[i];
+            }
+            _written += length;
+        }
+
+        return done();
+    }
+
+private:
+    const uint8_t *_source = nullptr;
+    uint8_t *_destination = nullptr;
+    int _size = 0;
+    int _written = 0;
+    uint8_t _flags = 0;
+    uint8_t _flag_bits = 0;
+};
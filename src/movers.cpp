@@ -0,0 +1,139 @@
+#include <bn_assert.h>
+
+#include <cstring>
+
+#include "movers.h"
+
+void mover_vm::start(const level_ptr &level)
+{
+    BN_ASSERT(level.movers.count <= MOVER_COUNT, "Too many movers: ", level.movers.count);
+
+    entity_store &entities = physics_manager::instance().entities;
+    _code = level.mover_code;
+    _count = level.movers.count;
+    _first = 0;
+
+    for (int index = 0; index < _count; ++index)
+    {
+        const level_mover &mover = level.movers.items[index];
+        int id = FIRST_MOVER_ID + index;
+        entities.spawn(id, mover.position.x, mover.position.y, ENTITY_SIZE, ENTITY_SIZE, 0);
+        physics_manager::instance().sweep.moved(id, entities.x[id]);
+        _states[index] = {mover.script, 0, 0, 0, false};
+    }
+}
+
+void mover_vm::update()
+{
+    int budget = MOVER_FRAME_BUDGET;
+    int index = _first;
+    for (int run = 0; run < _count; ++run)
+    {
+        _run(index, budget);
+        if (++index == _count)
+            index = 0;
+    }
+
+    if (++_first >= _count)
+        _first = 0;
+}
+
+void mover_vm::_run(int index, int &budget)
+{
+    auto &pm = physics_manager::instance();
+    entity_store &entities = pm.entities;
+    mover_state &state = _states[index];
+    int id = FIRST_MOVER_ID + index;
+
+    // Decode until something takes frames, the mover's limit is hit or the frame's budget runs out
+    for (int steps = MOVER_STEP_LIMIT; state.frames == 0 && !state.halted && steps > 0 && budget > 0; --steps)
+    {
+        const uint8_t *instruction = _code + state.script + state.pc;
+        --budget;
+
+        switch (instruction[0])
+        {
+        case MOVER_MOVE:
+            entities.velocity_x[id] = fixed_t<4>::from_data(int8_t(instruction[1]));
+            entities.velocity_y[id] = fixed_t<4>::from_data(int8_t(instruction[2]));
+            state.frames = instruction[3];
+            break;
+
+        case MOVER_WAIT:
+            entities.velocity_x[id] = 0;
+            entities.velocity_y[id] = 0;
+            state.frames = instruction[1];
+            break;
+
+        case MOVER_GOTO:
+            state.pc = instruction[1];
+            continue;
+
+        case MOVER_REPEAT:
+            state.count = instruction[1];
+            break;
+
+        case MOVER_NEXT:
+            if (--state.count != 0)
+            {
+                state.pc = instruction[1];
+                continue;
+            }
+            break;
+
+        case MOVER_NEAR:
+        {
+            fixed distance = entities.x[PLAYER_ID] - entities.x[id];
+            if (distance > instruction[1] || distance < -instruction[1])
+            {
+                steps = 1; // tried again next frame
+                continue;
+            }
+            break;
+        }
+
+        case MOVER_HAZARD:
+            entities.set_flag(id, ENTITY_HAZARD, instruction[1]);
+            break;
+
+        default:
+            state.halted = true;
+            continue;
+        }
+
+        state.pc += 1 + MOVER_OPERANDS[instruction[0]];
+    }
+
+    // A move that's blocked waits for room instead of counting down, so the mover never drifts off its path
+    if (state.frames > 0 && pm.move_kinematic(id, entities.velocity_x[id], entities.velocity_y[id]))
+    {
+        --state.frames;
+    }
+}
+
+bool mover_vm::touches_hazard(int id) const
+{
+    const entity_store &entities = physics_manager::instance().entities;
+
+    // Touching is overlapping once grown by a pixel each way
+    entity_bounds reach(entities.x[id], entities.y[id], ENTITY_SIZE + 2, ENTITY_SIZE + 2);
+    for (int index = 0; index < _count; ++index)
+    {
+        int mover = FIRST_MOVER_ID + index;
+        if ((entities.flags[mover] & ENTITY_HAZARD) && bounds_overlap(reach, entities.bounds(mover)))
+            return true;
+    }
+    return false;
+}
+
+void mover_vm::save_state(uint8_t *out) const
+{
+    std::memcpy(out, _states, sizeof(_states));
+    std::memcpy(out + sizeof(_states), &_first, sizeof(_first));
+}
+
+void mover_vm::load_state(const uint8_t *in)
+{
+    std::memcpy(_states, in, sizeof(_states));
+    std::memcpy(&_first, in + sizeof(_states), sizeof(_first));
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+#include "physics.h"
+
+// Mover script opcodes. An instruction is its opcode byte followed by MOVER_OPERANDS[opcode] operand bytes,
+// jump targets are byte offsets from the start of the script. scripts/convert-tiles.py assembles the Tiled
+// `script` property of mover objects into this.
+enum mover_opcode : uint8_t
+{
+    MOVER_END,    // stops the script for good
+    MOVER_MOVE,   // vx, vy, frames: moves by (vx, vy) sixteenths of a pixel every frame for that many frames
+    MOVER_WAIT,   // frames: stands still
+    MOVER_GOTO,   // target
+    MOVER_REPEAT, // count: sets the loop counter, 1 to 255
+    MOVER_NEXT,   // target: counts the loop counter down, jumps to target until it reaches zero
+    MOVER_NEAR,   // pixels: waits until the player is at most that far away horizontally
+    MOVER_HAZARD, // on: whether touching the mover hurts
+    MOVER_OPCODE_COUNT
+};
+
+constexpr uint8_t MOVER_OPERANDS[MOVER_OPCODE_COUNT] = {0, 3, 1, 1, 1, 1, 1, 1};
+
+// Instructions one mover may run in a frame before it has to yield, so a loop without a move or wait in it
+// stalls that mover instead of the game
+constexpr int MOVER_STEP_LIMIT = 8;
+
+// Instructions every mover together may run in a frame. Movers left without budget carry on with their current
+// move or wait and decode their next instruction on a later frame, the first mover to run goes round each frame.
+constexpr int MOVER_FRAME_BUDGET = 64;
+
+// Runs the scripts of the level's movers: kinematic entities at ids FIRST_MOVER_ID and up that platforms,
+// crushers and patrolling hazards are made of. Moves and waits take no instructions while they last, so the
+// interpreter costs a few instructions per mover per script step, never more than MOVER_FRAME_BUDGET a frame.
+class mover_vm
+{
+public:
+    // Spawns the level's movers at the start of their scripts
+    void start(const level_ptr &level);
+
+    // Runs every mover for one frame, before the physics step
+    void update();
+
+    // Whether an entity touches a mover that hurts
+    [[nodiscard]] bool touches_hazard(int id) const;
+
+    [[nodiscard]] int count() const { return _count; }
+
+    // Size of the byte image save_state() writes, the code and mover count come from the level and aren't in it
+    [[nodiscard]] static constexpr int state_size() { return int(sizeof(_states) + sizeof(_first)); }
+
+    void save_state(uint8_t *out) const;
+    void load_state(const uint8_t *in);
+
+private:
+    struct mover_state
+    {
+        uint16_t script; // offset of the script in the level's mover code
+        uint8_t pc;      // offset of the next instruction in the script
+        uint8_t frames;  // left of the current move or wait
+        uint8_t count;   // loop counter
+        bool halted;
+    };
+
+    const uint8_t *_code = nullptr;
+    int _count = 0;
+    mover_state _states[MOVER_COUNT] = {};
+    int _first = 0; // mover that runs first this frame
+
+    void _run(int index, int &budget);
+};
@@ -0,0 +1,63 @@
+#include <bn_regular_bg_item.h>
+#include <bn_span.h>
+
+#include "layers.h"
+#include "parallax_bg.h"
+
+namespace
+{
+    bn::regular_bg_ptr create_bg(const bn::regular_bg_item &item)
+    {
+        bn::regular_bg_ptr bg = item.create_bg(0, 0);
+        bg.set_priority(PARALLAX_PRIORITY);
+        return bg;
+    }
+}
+
+parallax_bg::parallax_bg(const bn::regular_bg_item &item, const level_table<parallax_band> &bands,
+                         const bn::camera_ptr &camera)
+    : _bg(create_bg(item)),
+      _camera(camera),
+      _factors(),
+      _offsets(),
+      _hbe(bn::regular_bg_position_hbe_ptr::create_horizontal(_bg, _offsets))
+{
+    // Each line takes the band it falls in, the first band starts at line 0
+    int index = 0;
+    for (int line = 0; line < LINES; ++line)
+    {
+        while (index + 1 < bands.count && bands.items[index + 1].top <= line)
+            ++index;
+
+        const parallax_band *band = bands.count ? &bands.items[index] : nullptr;
+        _factors[line] = band ? band->factor + band->slope * (line - band->top) : 0;
+    }
+
+    _camera_x = _camera.x().floor_integer();
+    _camera_y = _camera.y().floor_integer();
+    _fill();
+}
+
+void parallax_bg::update()
+{
+    int camera_x = _camera.x().floor_integer();
+    int camera_y = _camera.y().floor_integer();
+    if (camera_x == _camera_x && camera_y == _camera_y)
+        return;
+
+    _camera_x = camera_x;
+    _camera_y = camera_y;
+    _fill();
+}
+
+void parallax_bg::_fill()
+{
+    // The background isn't attached to the camera: a line moving at factor f sits at -f times the camera position.
+    // Vertically the whole layer moves at the top band's factor, one register write instead of a table.
+    for (int line = 0; line < LINES; ++line)
+    {
+        _offsets[line] = -((_camera_x * _factors[line]) >> 12);
+    }
+    _bg.set_y(-((_camera_y * _factors[0]) >> 12));
+    _hbe.reload_deltas_ref();
+}
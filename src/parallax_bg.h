@@ -0,0 +1,39 @@
+#pragma once
+
+#include <bn_camera_ptr.h>
+#include <bn_display.h>
+#include <bn_fixed.h>
+#include <bn_regular_bg_position_hbe_ptr.h>
+#include <bn_regular_bg_ptr.h>
+
+#include "level.h"
+
+// Background behind the level whose horizontal scroll changes per scanline, by the level's parallax bands.
+// Butano's H-Blank effect has DMA write each line's offset, so the CPU only refills the offset table,
+// and only on frames the camera moved to another pixel.
+// The effect reads the table in place, so a parallax_bg can't be copied or moved.
+class parallax_bg
+{
+public:
+    parallax_bg(const bn::regular_bg_item &item, const level_table<parallax_band> &bands,
+                const bn::camera_ptr &camera);
+
+    parallax_bg(const parallax_bg &) = delete;
+    parallax_bg &operator=(const parallax_bg &) = delete;
+
+    // Call once per frame after moving the camera
+    void update();
+
+private:
+    static constexpr int LINES = bn::display::height();
+
+    bn::regular_bg_ptr _bg;
+    bn::camera_ptr _camera;
+    int _factors[LINES];        // scroll factor of each line, in 1/4096ths of the camera's movement
+    bn::fixed _offsets[LINES];  // horizontal position of each line, read by the H-Blank effect
+    bn::regular_bg_position_hbe_ptr _hbe;
+    int _camera_x = 0;
+    int _camera_y = 0;
+
+    void _fill();
+};
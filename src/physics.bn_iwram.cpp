@@ -0,0 +1,525 @@
+// Per-frame physics step, compiled as ARM code and run from IWRAM.
+// Everything that scales with the clone count lives here: the broadphase, level sweeps and the push solver.
+
+#include "physics.h"
+
+// Compiled from physics_rom.cpp instead when the step is kept in ROM
+#if !defined(BLINX_PHYSICS_IN_ROM) || defined(BLINX_PHYSICS_ROM_COPY)
+
+void entity_sweep::build(const entity_store &entities)
+{
+    // Keep last frame's order for the survivors, then append anything spawned since
+    bool listed[ENTITY_COUNT] = {};
+    int kept = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        int id = ids[i];
+        if (entities.alive(id))
+        {
+            ids[kept++] = uint8_t(id);
+            listed[id] = true;
+        }
+    }
+    for (int id = 0; id < ENTITY_COUNT; ++id)
+    {
+        if (entities.alive(id) && !listed[id])
+        {
+            ids[kept++] = uint8_t(id);
+        }
+    }
+    count = kept;
+    drift = 0;
+
+    // Entities only move a few pixels a frame, so the order is nearly sorted and insertion sort is close to linear
+    for (int i = 0; i < count; ++i)
+    {
+        int id = ids[i];
+        fixed x = entities.x[id];
+        built_x[id] = x;
+
+        int j = i;
+        for (; j > 0 && sorted_x[j - 1] > x; --j)
+        {
+            ids[j] = ids[j - 1];
+            sorted_x[j] = sorted_x[j - 1];
+        }
+        ids[j] = uint8_t(id);
+        sorted_x[j] = x;
+    }
+}
+
+entity_sweep::range entity_sweep::near(fixed x) const
+{
+    // Boxes overlap less than a box width apart, plus however far anything has moved since the build
+    fixed reach = ENTITY_SIZE + drift;
+    fixed low = x - reach;
+    fixed high = x + reach;
+
+    // Hand-rolled binary searches, library templates would be emitted outside IWRAM
+    int begin = 0;
+    int end = count;
+    while (begin < end)
+    {
+        int middle = (begin + end) >> 1;
+        if (sorted_x[middle] < low)
+            begin = middle + 1;
+        else
+            end = middle;
+    }
+
+    int first = begin;
+    end = count;
+    while (begin < end)
+    {
+        int middle = (begin + end) >> 1;
+        if (sorted_x[middle] <= high)
+            begin = middle + 1;
+        else
+            end = middle;
+    }
+
+    return {ids + first, ids + begin};
+}
+
+// Whether any tile of one column within a row span has one of the flags in mask
+bool column_blocked(int column, int first_row, int last_row, int mask)
+{
+    for (int row = first_row; row <= last_row; ++row)
+    {
+        if (tile_attributes(column, row) & mask)
+            return true;
+    }
+    return false;
+}
+
+// Whether any tile of one row within a column span has one of the flags in mask
+bool row_blocked(int row, int first_column, int last_column, int mask)
+{
+    for (int column = first_column; column <= last_column; ++column)
+    {
+        if (tile_attributes(column, row) & mask)
+            return true;
+    }
+    return false;
+}
+
+fixed sweep_x(const entity_bounds &box, fixed dx, int blocked_by)
+{
+    int first_row = to_tile(box.top);
+    int last_row = to_tile(box.bottom);
+
+    if (dx > 0)
+    {
+        int last_column = to_tile(box.right + dx);
+        for (int column = to_tile(box.right) + 1; column <= last_column; ++column)
+        {
+            if (column_blocked(column, first_row, last_row, blocked_by))
+            {
+                // Stop with the right edge on the last free pixel, never back off
+                fixed contact = to_pixel(column) - 1 - box.right;
+                return contact > 0 ? contact : fixed(0);
+            }
+        }
+    }
+    else if (dx < 0)
+    {
+        int last_column = to_tile(box.left + dx);
+        for (int column = to_tile(box.left) - 1; column >= last_column; --column)
+        {
+            if (column_blocked(column, first_row, last_row, blocked_by))
+            {
+                fixed contact = to_pixel(column + 1) - box.left;
+                return contact < 0 ? contact : fixed(0);
+            }
+        }
+    }
+
+    return dx;
+}
+
+fixed sweep_y(const entity_bounds &box, fixed dy, int blocked_by)
+{
+    int first_column = to_tile(box.left);
+    int last_column = to_tile(box.right);
+
+    if (dy > 0)
+    {
+        int mask = blocked_by | TILE_ONE_WAY;
+        int last_row = to_tile(box.bottom + dy);
+        for (int row = to_tile(box.bottom) + 1; row <= last_row; ++row)
+        {
+            if (row_blocked(row, first_column, last_column, mask))
+            {
+                fixed contact = to_pixel(row) - 1 - box.bottom;
+                return contact > 0 ? contact : fixed(0);
+            }
+        }
+    }
+    else if (dy < 0)
+    {
+        int last_row = to_tile(box.top + dy);
+        for (int row = to_tile(box.top) - 1; row >= last_row; --row)
+        {
+            if (row_blocked(row, first_column, last_column, blocked_by))
+            {
+                fixed contact = to_pixel(row + 1) - box.top;
+                return contact < 0 ? contact : fixed(0);
+            }
+        }
+    }
+
+    return dy;
+}
+
+int ground_under(const entity_bounds &box)
+{
+    int row = to_tile(box.bottom + 1);
+    int flags = 0;
+    for (int column = to_tile(box.left); column <= to_tile(box.right); ++column)
+    {
+        flags |= tile_attributes(column, row);
+    }
+    return flags;
+}
+
+void physics_manager::step()
+{
+    // One branch a frame picks the level's instantiation, everything under it runs on constants
+    switch (level->physics)
+    {
+    case PHYSICS_LOW_GRAVITY:
+        _step<low_gravity_physics>();
+        break;
+
+    default:
+        _step<default_physics>();
+        break;
+    }
+}
+
+template<typename Config>
+void physics_manager::_step()
+{
+    // Ghosts step too, against the level only, so a recording clone previews where its loop will go
+    for (int id = 0; id < FIRST_MOVER_ID; ++id)
+    {
+        if (entities.alive(id))
+        {
+            _step<Config>(id);
+        }
+    }
+}
+
+template<typename Config>
+void physics_manager::_step(int id)
+{
+    // Ice and conveyors act through what the entity found under it last step, as table lookups
+    int ground = entities.ground[id];
+    fixed_t<4> traction = Config::traction[(ground / TILE_ICE) & 1];
+    fixed_t<4> change = entities.walk_x[id] - entities.velocity_x[id];
+    change = change > traction ? traction : change < -traction ? -traction : change;
+    entities.velocity_x[id] += change;
+    move_horizontal(id, entities.velocity_x[id] + CONVEYOR_SPEED[(ground / TILE_CONVEYOR) & 1]);
+
+    // Apply gravity and vertical movement
+    entities.velocity_y[id] += Config::gravity;
+    move_vertical(id);
+
+    // Jumping
+    if (entities.flags[id] & ENTITY_JUMP)
+    {
+        if (entities.jump_count[id] < Config::max_jumps)
+        {
+            entities.velocity_y[id] = Config::jump_velocity;
+            entities.jump_count[id]++;
+            entities.set_flag(id, ENTITY_ON_GROUND, false);
+        }
+        entities.set_flag(id, ENTITY_JUMP, false);
+    }
+
+    entities.ground[id] = uint8_t(ground_under(entities.level_bounds(id)));
+}
+
+void physics_manager::move_horizontal(int id, fixed distance)
+{
+    if (distance == 0)
+        return;
+
+    // Slide up to the wall, then push whatever entities are in the way
+    fixed dx = sweep_x(entities.level_bounds(id), distance, entities.blocked_by[id]);
+    if (dx != 0)
+    {
+        auto push_result = try_push_horizontal(id, entities.x[id] + dx);
+
+        if (push_result.success)
+        {
+            // Apply the push to all entities
+            apply_push(push_result, id, dx);
+        }
+    }
+}
+
+void physics_manager::move_vertical(int id)
+{
+    if (entities.velocity_y[id] == 0)
+        return;
+
+    fixed velocity = entities.velocity_y[id];
+    fixed dy = sweep_y(entities.level_bounds(id), velocity, entities.blocked_by[id]);
+
+    // Both the level and entities stop the move flush against whatever is in the way
+    bool blocked = dy != velocity;
+    if (dy != 0)
+    {
+        // Something resting on an entity finds it in the contact cache, anything else has to look
+        int other = velocity > 0 ? supporter(id) : NO_ENTITY;
+        if (other == NO_ENTITY)
+        {
+            other = entity_contact(id, dy);
+        }
+
+        if (other != NO_ENTITY)
+        {
+            // Boxes touch without overlapping one box height minus a pixel apart, never back off
+            fixed gap = entities.y[other] - entities.y[id];
+            if (velocity > 0)
+            {
+                gap -= ENTITY_SIZE - 1;
+                dy = gap > 0 ? gap : fixed(0);
+                entities.set_support(id, other);
+            }
+            else
+            {
+                gap += ENTITY_SIZE - 1;
+                dy = gap < 0 ? gap : fixed(0);
+            }
+            blocked = true;
+        }
+
+        if (dy != 0)
+        {
+            entities.y[id] += dy;
+            entities.set_flag(id, ENTITY_ON_GROUND, false);
+        }
+    }
+
+    if (blocked)
+    {
+        // Landing on something resets the jumps, bumping a ceiling only stops the rise
+        if (velocity > 0)
+        {
+            entities.set_flag(id, ENTITY_ON_GROUND, true);
+            entities.jump_count[id] = 0;
+        }
+        entities.velocity_y[id] = 0;
+    }
+}
+
+// Whether the mover would overlap another entity at a test position, ghosts never collide
+bool physics_manager::would_collide(int mover, fixed test_x, fixed test_y, int other)
+{
+    if (mover == other)
+        return false;
+
+    PHYSICS_STAT(entity_queries);
+
+    if (!entities.solid(mover) || !entities.solid(other))
+        return false;
+
+    return bounds_overlap(entity_bounds(test_x, test_y), entities.bounds(other));
+}
+
+// The entity this one was last found resting on, while the two are still where they were relative to each other.
+// Touching depends only on relative position, so moving both together (a carried rider) keeps the contact.
+int physics_manager::supporter(int id) const
+{
+    int other = entities.support[id];
+    if (other == NO_ENTITY || !entities.solid(other) ||
+        entities.x[id] - entities.x[other] != entities.support_dx[id] ||
+        entities.y[id] - entities.y[other] != entities.support_dy[id])
+        return NO_ENTITY;
+
+    return other;
+}
+
+push_result physics_manager::try_push_horizontal(int pusher, fixed target_x)
+{
+    push_result result;
+    fixed movement = target_x - entities.x[pusher];
+
+    // Entities that will move, as a bit per id, and the same entities in the order they were found.
+    // Every entity joins at most once, so the solver is bounded by one sweep window scan per entity.
+    uint64_t moving = uint64_t(1) << pusher;
+    int chain[ENTITY_COUNT];
+    int chain_size = 0;
+    chain[chain_size++] = pusher;
+
+    // Walk the contact graph outwards from the pusher: anything a moving entity would run into has to move too,
+    // and a single one of them against a wall stops the whole chain
+    for (int i = 0; i < chain_size; ++i)
+    {
+        int mover = chain[i];
+        fixed mover_target = entities.x[mover] + movement;
+
+        for (int id : sweep.near(mover_target))
+        {
+            if ((moving & (uint64_t(1) << id)) || !entities.alive(id) ||
+                !would_collide(mover, mover_target, entities.y[mover], id))
+                continue;
+
+            // Movers only go where their script takes them
+            if (id >= FIRST_MOVER_ID ||
+                sweep_x(entities.level_bounds(id), movement, entities.blocked_by[id]) != movement)
+                return result;
+
+            moving |= uint64_t(1) << id;
+            chain[chain_size++] = id;
+        }
+    }
+
+    if (chain_size > 1)
+    {
+        PHYSICS_STAT(push_resolutions);
+    }
+
+    // Riders are carried along with whatever they stand on, stacks included, when they have room to move.
+    // A rider that doesn't is left behind instead of blocking the push.
+    for (int i = 0; i < chain_size; ++i)
+    {
+        int carrier = chain[i];
+
+        for (int rider : sweep.near(entities.x[carrier]))
+        {
+            if ((moving & (uint64_t(1) << rider)) || supporter(rider) != carrier)
+                continue;
+
+            if (sweep_x(entities.level_bounds(rider), movement, entities.blocked_by[rider]) != movement)
+                continue;
+
+            fixed rider_target = entities.x[rider] + movement;
+            bool blocked = false;
+            for (int id : sweep.near(rider_target))
+            {
+                if (!(moving & (uint64_t(1) << id)) && entities.alive(id) &&
+                    would_collide(rider, rider_target, entities.y[rider], id))
+                {
+                    blocked = true;
+                    break;
+                }
+            }
+
+            if (!blocked)
+            {
+                moving |= uint64_t(1) << rider;
+                chain[chain_size++] = rider;
+            }
+        }
+    }
+
+    result.success = true;
+    result.final_position = target_x;
+    for (int i = 1; i < chain_size; ++i)
+    {
+        result.pushed_entities.push_back(chain[i]);
+    }
+
+    return result;
+}
+
+// The nearest entity in the way of a vertical move, NO_ENTITY if there is none
+int physics_manager::entity_contact(int id, fixed dy)
+{
+    fixed test_y = entities.y[id] + dy;
+    int nearest = NO_ENTITY;
+
+    for (int other : sweep.near(entities.x[id]))
+    {
+        if (entities.alive(other) && would_collide(id, entities.x[id], test_y, other))
+        {
+            // Falling runs into the highest entity first, rising into the lowest
+            if (nearest == NO_ENTITY ||
+                (dy > 0 ? entities.y[other] < entities.y[nearest] : entities.y[other] > entities.y[nearest]))
+            {
+                nearest = other;
+            }
+        }
+    }
+
+    return nearest;
+}
+
+bool physics_manager::move_kinematic(int id, fixed dx, fixed dy)
+{
+    if (dx != 0)
+    {
+        push_result result = try_push_horizontal(id, entities.x[id] + dx);
+        if (!result.success)
+            return false;
+
+        apply_push(result, id, dx);
+    }
+
+    return dy == 0 || move_kinematic_vertical(id, dy);
+}
+
+// Vertical counterpart of the chain push, for movers only: everything the move would run into goes along,
+// transitively, and fails it if there's no room. Riders are carried when they have room, left behind otherwise.
+bool physics_manager::move_kinematic_vertical(int id, fixed dy)
+{
+    uint64_t moving = uint64_t(1) << id;
+    int chain[ENTITY_COUNT];
+    int chain_size = 0;
+    chain[chain_size++] = id;
+
+    for (int i = 0; i < chain_size; ++i)
+    {
+        int carrier = chain[i];
+        fixed carrier_target = entities.y[carrier] + dy;
+
+        for (int other : sweep.near(entities.x[carrier]))
+        {
+            if ((moving & (uint64_t(1) << other)) || !entities.alive(other))
+                continue;
+
+            bool in_way = would_collide(carrier, entities.x[carrier], carrier_target, other);
+            if (!in_way && supporter(other) != carrier)
+                continue;
+
+            if (other >= FIRST_MOVER_ID ||
+                sweep_y(entities.level_bounds(other), dy, entities.blocked_by[other]) != dy)
+            {
+                if (in_way)
+                    return false;
+                continue;
+            }
+
+            moving |= uint64_t(1) << other;
+            chain[chain_size++] = other;
+        }
+    }
+
+    if (chain_size > 1)
+    {
+        PHYSICS_STAT(push_resolutions);
+    }
+
+    for (int i = 0; i < chain_size; ++i)
+    {
+        entities.y[chain[i]] += dy;
+    }
+    return true;
+}
+
+void physics_manager::apply_push(const push_result &result, int pusher, fixed movement)
+{
+    entities.x[pusher] = result.final_position;
+    sweep.moved(pusher, result.final_position);
+
+    for (int pushed : result.pushed_entities)
+    {
+        entities.x[pushed] += movement;
+        sweep.moved(pushed, entities.x[pushed]);
+    }
+}
+
+#endif
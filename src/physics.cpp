@@ -1,26 +1,247 @@
+#include <bn_assert.h>
+
+#include <cstring>
+
 #include "physics.h"
+#include "entities.h"
+
+namespace
+{
+    // FNV-1a over whole words instead of bytes, a quarter of the multiplies
+    struct word_hash
+    {
+        uint32_t value = 2166136261u;
+
+        void add(int word)
+        {
+            value = (value ^ uint32_t(word)) * 16777619u;
+        }
+    };
+}
+
+void physics_manager::set_input(int id, int code)
+{
+    switch (level->physics)
+    {
+    case PHYSICS_LOW_GRAVITY:
+        entities.set_input<low_gravity_physics>(id, code);
+        break;
+
+    default:
+        entities.set_input<default_physics>(id, code);
+        break;
+    }
+}
+
+void player_ptr::update(int input)
+{
+    physics_manager::instance().set_input(PLAYER_ID, input);
+}
+
+// Check if respawn position would overlap with other entities, ghosts pass through and don't count
+bool clone_ptr::check_respawn_collision(int my_slot) const
+{
+    auto &pm = physics_manager::instance();
+    const entity_store &entities = pm.entities;
+    entity_bounds my_bounds(init_x, init_y);
+
+    for (int id : pm.sweep.near(init_x))
+    {
+        if (id != my_slot && entities.solid(id) && bounds_overlap(my_bounds, entities.bounds(id)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void clone_ptr::stop_recording()
+{
+    // Stays a ghost until playback respawns it at the start, so the preview never collides where it ended
+    recording = false;
+    h = 0;
+}
+
+bool clone_ptr::update(int my_slot, int input)
+{
+    if (recording)
+    {
+        // Recording phase - ghost mode (no entity collisions), moving with the input it records as a preview
+        int code = input & (LEFT | RIGHT | JUMP | DASH);
+        history.record(code);
+        physics_manager::instance().set_input(my_slot, code);
+        h += 1;
+        if (h == loop_frames)
+        {
+            stop_recording();
+        }
+        return false; // Continue existing
+    }
+
+    // Playback phase - normal physics
+    auto &pm = physics_manager::instance();
+    entity_store &entities = pm.entities;
+    if (h == 0)
+    {
+        // Check if respawn position is blocked
+        if (check_respawn_collision(my_slot))
+        {
+            return true; // Signal for destruction
+        }
+
+        entities.spawn(my_slot, init_x, init_y, ENTITY_SIZE, ENTITY_SIZE, 0);
+        pm.sweep.moved(my_slot, init_x);
+        history.rewind();
+    }
+
+    pm.set_input(my_slot, history.next());
+
+    // Counter instead of a modulo, the ARM7 has no divide instruction
+    if (++h == loop_frames)
+    {
+        h = 0;
+    }
+    return false; // Continue existing
+}
 
-// Entity bounds implementation
-entity_bounds::entity_bounds(fixed x, fixed y)
+world::world(const level_ptr &level_)
+    : level(level_)
 {
-    constexpr int sprite_width = 32;
-    constexpr int sprite_height = 32;
-    left = x - sprite_width / 2;
-    right = x + sprite_width / 2 - 1;
-    top = y - sprite_height / 2;
-    bottom = y + sprite_height / 2 - 1;
+    BN_ASSERT(level.loop_frames > 0 && level.loop_frames <= MAX_LOOP_FRAMES, "Invalid loop_frames: ",
+              level.loop_frames);
+
+    auto &pm = physics_manager::instance();
+    pm.level = &level;
+    pm.entities = entity_store();
+    pm.sweep = entity_sweep();
+    spawn_player();
+    movers.start(level);
 }
 
-// Check if two entity bounds overlap
-bool bounds_overlap(const entity_bounds &a, const entity_bounds &b)
+void world::spawn_player()
 {
-    return a.left < b.right && a.right > b.left &&
-           a.top < b.bottom && a.bottom > b.top;
+    // Slightly narrower than clones against the level, centered in the start tile so the box starts inside the map
+    auto &pm = physics_manager::instance();
+    fixed x = to_pixel(level.init_x) + TILE_SIZE / 2;
+    pm.entities.spawn(PLAYER_ID, x, to_pixel(level.init_y) + TILE_SIZE / 2, 31, 31, 0);
+    pm.sweep.moved(PLAYER_ID, x);
+}
+
+void world::update(int input)
+{
+    auto &pm = physics_manager::instance();
+    entity_store &entities = pm.entities;
+
+    if (input & SPAWN)
+    {
+        // Built in place, evicting the oldest clone when the pool is full.
+        // An evicted slot is reused right away, so its store entry is simply overwritten.
+        int slot = clones.spawn(entities.x[PLAYER_ID].integer(), entities.y[PLAYER_ID].integer(), level.loop_frames);
+        const clone_ptr &clone = clones[slot];
+        entities.spawn(slot, clone.init_x, clone.init_y, ENTITY_SIZE, ENTITY_SIZE, ENTITY_GHOST);
+    }
+
+    pm.begin_frame();
+
+    // Update clone controllers newest first, retiring one never moves the others
+    for (int slot = clones.newest(); slot >= 0;)
+    {
+        int older = clones.older(slot);
+        bool should_destroy = clones[slot].update(slot, input);
+        if (should_destroy)
+        {
+            clones.retire(slot);
+            entities.despawn(slot);
+        }
+        slot = older;
+    }
+
+    player.update(input);
+
+    // Scripted movers go first, so whatever they shove or carry still gets its own move this frame
+    movers.update();
+
+    // One linear physics pass over the store
+    pm.step();
+
+    // Hazards end clones for good and send the player back to the start, ghosts pass through them
+    for (int slot = clones.newest(); slot >= 0;)
+    {
+        int older = clones.older(slot);
+        if (!entities.ghost(slot) && hurt(slot))
+        {
+            clones.retire(slot);
+            entities.despawn(slot);
+        }
+        slot = older;
+    }
+    if (hurt(PLAYER_ID))
+    {
+        spawn_player();
+    }
+
+    ++frame;
 }
 
-// Singleton instance
-physics_manager &physics_manager::instance()
+bool world::hurt(int id) const
 {
-    static physics_manager inst;
-    return inst;
-}
\ No newline at end of file
+    return (physics_manager::instance().entities.ground[id] & TILE_HAZARD) || movers.touches_hazard(id);
+}
+
+void world::save_state(uint8_t *out) const
+{
+    const auto &pm = physics_manager::instance();
+    std::memcpy(out, &pm.entities, sizeof(entity_store));
+    out += sizeof(entity_store);
+    std::memcpy(out, &pm.sweep, sizeof(entity_sweep));
+    out += sizeof(entity_sweep);
+    clones.save_state(out);
+    out += clone_pool::state_size();
+    movers.save_state(out);
+    out += mover_vm::state_size();
+    std::memcpy(out, &frame, sizeof(int));
+}
+
+void world::load_state(const uint8_t *in)
+{
+    auto &pm = physics_manager::instance();
+    std::memcpy(&pm.entities, in, sizeof(entity_store));
+    in += sizeof(entity_store);
+    std::memcpy(&pm.sweep, in, sizeof(entity_sweep));
+    in += sizeof(entity_sweep);
+    clones.load_state(in);
+    in += clone_pool::state_size();
+    movers.load_state(in);
+    in += mover_vm::state_size();
+    std::memcpy(&frame, in, sizeof(int));
+}
+
+uint32_t world::hash() const
+{
+    const entity_store &entities = physics_manager::instance().entities;
+    word_hash result;
+    result.add(frame);
+
+    for (int id = 0; id < ENTITY_COUNT; ++id)
+    {
+        if (!entities.alive(id))
+            continue;
+
+        result.add(id);
+        result.add(entities.x[id].data());
+        result.add(entities.y[id].data());
+        result.add(entities.velocity_x[id].data());
+        result.add(entities.velocity_y[id].data());
+        result.add(entities.flags[id] | (entities.jump_count[id] << 8));
+    }
+
+    for (int slot = clones.oldest(); slot >= 0; slot = clones.newer(slot))
+    {
+        const clone_ptr &clone = clones[slot];
+        result.add(slot);
+        result.add(clone.h | (clone.recording << 16));
+    }
+
+    return result.value;
+}
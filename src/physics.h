@@ -1,19 +1,74 @@
 #pragma once
 
-#include <bn_core.h>
+#include <bn_common.h>
 #include <bn_vector.h>
 #include <bn_fixed.h>
-#include <bn_sprite_ptr.h>
-#include <bn_optional.h>
+
+#include "level.h"
 
 using namespace bn;
 
-// Entity bounds for collision detection
+// Input codes, shared by the keypad reader, clone recordings and host input scripts
+const int LEFT = 1;
+const int RIGHT = 2;
+const int JUMP = 4;
+const int DASH = 8;
+const int SPAWN = 16;
+#ifdef BLINX_CLONE_COUNT
+    const int CLONE_COUNT = BLINX_CLONE_COUNT;
+#else
+    const int CLONE_COUNT = 4;
+#endif
+#ifdef BLINX_MOVER_COUNT
+    const int MOVER_COUNT = BLINX_MOVER_COUNT;
+#else
+    const int MOVER_COUNT = 32;
+#endif
+
+// The per-frame physics step runs from IWRAM as ARM code.
+// PHYSICS_IN_ROM=1 leaves it in ROM as Thumb code instead, to measure the difference with the cycle benchmark.
+#ifdef BLINX_PHYSICS_IN_ROM
+    #define PHYSICS_CODE
+#else
+    #define PHYSICS_CODE BN_CODE_IWRAM
+#endif
+
+// Entity ids: clones use their pool slot and the player comes after them, so one pass in id order covers everyone
+// physics moves. Movers come last, their scripts move them (see movers.h).
+constexpr int PLAYER_ID = CLONE_COUNT;
+constexpr int FIRST_MOVER_ID = PLAYER_ID + 1;
+constexpr int ENTITY_COUNT = FIRST_MOVER_ID + MOVER_COUNT;
+constexpr int NO_ENTITY = 0xff;
+static_assert(ENTITY_COUNT <= 64, "Push sets are 64 bit masks");
+
+// Side of the box entities collide with each other by
+constexpr int ENTITY_SIZE = 32;
+
+constexpr int TILE_SHIFT = 5;
+constexpr int TILE_SIZE = 1 << TILE_SHIFT;
+constexpr int to_tile(int pixel) { return pixel >> TILE_SHIFT; }
+constexpr int to_pixel(int tile) { return tile * TILE_SIZE; }
+
+// Floors straight from the fixed point data, so pixels left of or above the map land on negative tiles
+constexpr int to_tile(fixed position) { return position.data() >> (fixed::precision() + TILE_SHIFT); }
+
+// Entity bounds for collision detection, edges are inclusive
 struct entity_bounds
 {
     fixed left, right, top, bottom;
 
-    entity_bounds(fixed x, fixed y);
+    entity_bounds(fixed x, fixed y, int width, int height)
+    {
+        left = x - width / 2;
+        right = x + width / 2 - 1;
+        top = y - height / 2;
+        bottom = y + height / 2 - 1;
+    }
+
+    entity_bounds(fixed x, fixed y)
+        : entity_bounds(x, y, ENTITY_SIZE, ENTITY_SIZE)
+    {
+    }
 };
 
 // Push result for chain pushing
@@ -21,63 +76,260 @@ struct push_result
 {
     bool success = false;
     fixed final_position = 0;
-    vector<int, 64> pushed_entities; // indices of entities that would be pushed
+    vector<int, ENTITY_COUNT> pushed_entities; // ids of the entities that move with the pusher, riders included
+};
+
+// Movement tuning as template arguments, so every physics_preset gets its own instantiation of the step and the
+// hot loop reads immediates instead of level data. Speeds are raw fixed_t<4> data, sixteenths of a pixel per frame:
+// velocities have that precision whatever the preset, so the entity store and saved states don't depend on it.
+// Dashing shifts the walking speed left by DashShift.
+template<int GravityData, int JumpData, int WalkData, int DashShift, int MaxJumps>
+struct physics_config
+{
+    static constexpr fixed_t<4> gravity = fixed_t<4>::from_data(GravityData);
+    static constexpr fixed_t<4> jump_velocity = fixed_t<4>::from_data(-JumpData);
+    static constexpr fixed_t<4> walk_speed = fixed_t<4>::from_data(WalkData);
+    static constexpr fixed_t<4> dash_speed = fixed_t<4>::from_data(WalkData << DashShift);
+    static constexpr int max_jumps = MaxJumps;
+
+    // How much horizontal speed can change in a frame, indexed by whether the entity stands on ice so applying it
+    // never branches: normally enough to go from a full dash one way to the other, on ice a fraction of a pixel
+    static constexpr fixed_t<4> traction[2] = {fixed_t<4>::from_data(WalkData << (DashShift + 1)), 0.125};
 };
 
-const fixed_t<4> GRAVITY = 0.25;
+// Jumps reach 72 pixels
+using default_physics = physics_config<4, 96, 32, 1, 1>;
+
+// Floatier jumps, 64 pixels high and twice as long in the air, with a second jump in mid air
+using low_gravity_physics = physics_config<2, 64, 32, 1, 2>;
 
-// Base entity interface for polymorphic collision handling
-struct entity_base
+// Conveyors carry whatever stands on them to the right, indexed like traction
+const fixed_t<4> CONVEYOR_SPEED[2] = {0, 1};
+
+// Entity flags
+const int ENTITY_ALIVE = 1;
+const int ENTITY_GHOST = 2;     // recording clone: moves with the live input, other entities ignore it
+const int ENTITY_ON_GROUND = 4;
+const int ENTITY_JUMP = 8;      // jump requested this frame
+const int ENTITY_HAZARD = 16;   // mover that hurts whatever touches it
+
+// Physics state of every entity, one array per field indexed by entity id.
+// The physics passes walk these arrays directly, the player and clones share every code path.
+struct entity_store
 {
-    fixed x() const { return _x; }
-    fixed y() const { return _y; }
-    virtual bool check_level_collision(fixed test_x, fixed test_y) const = 0;
-    virtual ~entity_base() = default;
-
-    optional<sprite_ptr> osp;
-    fixed_t<4> move_speed = 2;
-    fixed_t<4> velocity_y = 0;
-    fixed_t<4> velocity_x = 0;
-    int max_jumps = 1;
-    int jump_count = 0;
-    bool on_ground = false;
-
-    sprite_ptr *sp()
+    fixed x[ENTITY_COUNT];
+    fixed y[ENTITY_COUNT];
+    fixed_t<4> velocity_x[ENTITY_COUNT];
+    fixed_t<4> velocity_y[ENTITY_COUNT];
+    fixed_t<4> walk_x[ENTITY_COUNT]; // horizontal speed the input asks for, velocity_x follows it as traction allows
+    uint8_t width[ENTITY_COUNT];  // box tested against level tiles, sized per entity type
+    uint8_t height[ENTITY_COUNT];
+    uint8_t jump_count[ENTITY_COUNT];
+    uint8_t flags[ENTITY_COUNT] = {};
+    uint8_t blocked_by[ENTITY_COUNT]; // TILE_* flags of the tiles that stop this entity, clone blockers stop clones only
+    uint8_t ground[ENTITY_COUNT];     // TILE_* flags of the tiles under the entity after its last step
+
+    // Contact cache: the entity each one last landed on and where it was relative to it
+    uint8_t support[ENTITY_COUNT];
+    fixed support_dx[ENTITY_COUNT];
+    fixed support_dy[ENTITY_COUNT];
+
+    void spawn(int id, fixed new_x, fixed new_y, int box_width, int box_height, int new_flags)
+    {
+        x[id] = new_x;
+        y[id] = new_y;
+        velocity_x[id] = 0;
+        velocity_y[id] = 0;
+        walk_x[id] = 0;
+        width[id] = uint8_t(box_width);
+        height[id] = uint8_t(box_height);
+        jump_count[id] = 0;
+        flags[id] = uint8_t(ENTITY_ALIVE | new_flags);
+        blocked_by[id] = uint8_t(id == PLAYER_ID ? TILE_SOLID : TILE_SOLID | TILE_CLONE_BLOCKER);
+        ground[id] = 0;
+        support[id] = NO_ENTITY;
+    }
+
+    void set_support(int id, int other)
+    {
+        support[id] = uint8_t(other);
+        support_dx[id] = x[id] - x[other];
+        support_dy[id] = y[id] - y[other];
+    }
+
+    void despawn(int id)
+    {
+        flags[id] = 0;
+    }
+
+    bool alive(int id) const { return flags[id] & ENTITY_ALIVE; }
+    bool ghost(int id) const { return flags[id] & ENTITY_GHOST; }
+    bool on_ground(int id) const { return flags[id] & ENTITY_ON_GROUND; }
+
+    // Alive and taking part in physics and entity collisions
+    bool solid(int id) const { return (flags[id] & (ENTITY_ALIVE | ENTITY_GHOST)) == ENTITY_ALIVE; }
+
+    void set_flag(int id, int flag, bool value)
     {
-        return &osp.value();
+        flags[id] = uint8_t(value ? flags[id] | flag : flags[id] & ~flag);
     }
 
-    void set_position(fixed new_x, fixed new_y)
+    // Turns an input code into this frame's walking speed and jump request
+    template<typename Config>
+    void set_input(int id, int code)
     {
-        osp.value().set_position(new_x, new_y);
-        _x = new_x;
-        _y = new_y;
+        fixed_t<4> speed = (code & DASH) ? Config::dash_speed : Config::walk_speed;
+        walk_x[id] = 0;
+        if (code & LEFT)
+        {
+            walk_x[id] = -speed;
+        }
+        if (code & RIGHT)
+        {
+            walk_x[id] = speed;
+        }
+
+        set_flag(id, ENTITY_JUMP, code & JUMP);
     }
 
-    fixed _x = 0, _y = 0;
+    entity_bounds bounds(int id) const { return entity_bounds(x[id], y[id]); }
+    entity_bounds level_bounds(int id) const { return entity_bounds(x[id], y[id], width[id], height[id]); }
 };
 
-// Utility functions that don't need complete type information
-bool bounds_overlap(const entity_bounds &a, const entity_bounds &b);
+// Entity ids sorted by x, rebuilt once per frame and shared by every entity query made during it.
+// Entities keep moving after the build, so queries widen their window by the furthest any entity has
+// moved since, which keeps them exact without re-sorting mid-frame.
+struct entity_sweep
+{
+    // Ids in a window of the sorted order
+    struct range
+    {
+        const uint8_t *first;
+        const uint8_t *last;
 
-// Physics manager interface - implementations will be in main.cpp to avoid circular dependencies
-struct physics_manager
+        const uint8_t *begin() const { return first; }
+        const uint8_t *end() const { return last; }
+    };
+
+    // Sorts every alive entity, ghosts included, starting from last frame's order
+    PHYSICS_CODE void build(const entity_store &entities);
+
+    // Must be told about every x change between builds
+    void moved(int id, fixed new_x)
+    {
+        fixed distance = new_x > built_x[id] ? new_x - built_x[id] : built_x[id] - new_x;
+        if (distance > drift)
+            drift = distance;
+    }
+
+    // Entities whose collision box could overlap one centered at x, by where they were at the build
+    PHYSICS_CODE range near(fixed x) const;
+
+    uint8_t ids[ENTITY_COUNT];
+    fixed sorted_x[ENTITY_COUNT]; // built x of ids[i]
+    fixed built_x[ENTITY_COUNT];  // indexed by id
+    int count = 0;
+    fixed drift = 0;
+};
+
+// Check if two entity bounds overlap
+inline bool bounds_overlap(const entity_bounds &a, const entity_bounds &b)
+{
+    return a.left < b.right && a.right > b.left &&
+           a.top < b.bottom && a.bottom > b.top;
+}
+
+// Swept tile collision: how far a box can travel along one axis before touching a tile with any of the blocked_by
+// flags. Falling is also stopped by one-way tiles, which the scan only reaches when the box enters them from above.
+// Only the tile columns (or rows) the leading edge enters are read, so fast movers can't tunnel.
+// A blocked box stops flush against the tile, a free one gets the full distance back.
+PHYSICS_CODE fixed sweep_x(const entity_bounds &box, fixed dx, int blocked_by);
+PHYSICS_CODE fixed sweep_y(const entity_bounds &box, fixed dy, int blocked_by);
+
+// TILE_* flags of every tile in the row just under a box, ORed together
+PHYSICS_CODE int ground_under(const entity_bounds &box);
+
+// Work counters read by the host benchmark, only counted when BLINX_PHYSICS_STATS is defined
+struct physics_stats
 {
-    static physics_manager &instance();
+    int level_queries = 0;    // tile lookups made by tile_attributes()
+    int entity_queries = 0;   // entity-vs-entity overlap tests
+    int push_resolutions = 0; // pushes that had to check the entities in the way
+};
 
-    // Simple data storage - no complex logic here
-    void register_entities(void *player_2, void *clones_2)
+#ifdef BLINX_PHYSICS_STATS
+    #define PHYSICS_STAT(counter) (++physics_manager::instance().stats.counter)
+#else
+    #define PHYSICS_STAT(counter) ((void)0)
+#endif
+
+// Physics manager: owns the entity store and runs every physics pass over it.
+// The passes are defined in physics.bn_iwram.cpp.
+struct physics_manager
+{
+    // Singleton instance, inline so the hot collision queries don't pay for a call to reach it.
+    // Host tools run a separate simulation on every thread, so there it is one instance per thread.
+    static physics_manager &instance()
     {
-        this->player_ = player_2;
-        this->clones_ = clones_2;
+#ifdef BLINX_HOST
+        static thread_local physics_manager inst;
+#else
+        static physics_manager inst;
+#endif
+        return inst;
     }
 
-    // These will be implemented in main.cpp where complete types are available
-    push_result try_push_horizontal(int pusher_index, bool is_player, fixed target_x);
-    bool check_entity_support(int entity_index, bool is_player, fixed test_y);
-    void apply_push(const push_result &result, int pusher_index, bool is_player, fixed movement);
+    // Rebuilds the broadphase, call once per frame before any entity query
+    void begin_frame() { sweep.build(entities); }
+
+    // Input of an entity for this frame, with the speeds of the level's physics preset
+    void set_input(int id, int code);
+
+    // Moves the player and every solid clone one frame, in id order
+    PHYSICS_CODE void step();
+
+    // Move-and-slide for one axis
+    PHYSICS_CODE void move_horizontal(int id, fixed distance);
+    PHYSICS_CODE void move_vertical(int id);
+
+    PHYSICS_CODE bool would_collide(int mover, fixed test_x, fixed test_y, int other);
+    PHYSICS_CODE int supporter(int id) const;
+    PHYSICS_CODE int entity_contact(int id, fixed dy);
+
+    // Chain push: everything the pusher would run into moves with it, transitively, plus whatever rides on
+    // the moving entities. Fails without moving anything if any pushed entity is against a wall.
+    PHYSICS_CODE push_result try_push_horizontal(int pusher, fixed target_x);
+    PHYSICS_CODE void apply_push(const push_result &result, int pusher, fixed movement);
+
+    // Scripted move of a mover, which goes through the level but not through entities: whatever is in the way is
+    // shoved or lifted, riders go along. Returns false without moving if something in the way can't make room.
+    PHYSICS_CODE bool move_kinematic(int id, fixed dx, fixed dy);
+    PHYSICS_CODE bool move_kinematic_vertical(int id, fixed dy);
+
+    entity_store entities;
+    entity_sweep sweep;
+    const level_ptr *level = nullptr;
+    physics_stats stats;
+
+private:
+    // The step for one physics preset, instantiated in physics.bn_iwram.cpp
+    template<typename Config>
+    PHYSICS_CODE void _step();
+
+    template<typename Config>
+    PHYSICS_CODE void _step(int id);
+};
+
+// TILE_* flags of a tile in the active level, everything outside the map is solid
+inline int tile_attributes(int tile_x, int tile_y)
+{
+    const level_ptr *level = physics_manager::instance().level;
+    PHYSICS_STAT(level_queries);
+
+    // Negative tiles wrap to huge unsigned values, one compare per axis covers both edges
+    if (unsigned(tile_x) >= unsigned(level->size_x) ||
+        unsigned(tile_y) >= unsigned(level->size_y))
+        return TILE_SOLID;
 
-    // Store as void* to avoid circular dependency, cast in main.cpp
-    void *player_ = nullptr;
-    void *clones_ = nullptr;
-};
\ No newline at end of file
+    return attributes_at(*level, tile_x, tile_y);
+}
@@ -0,0 +1,7 @@
+// Thumb build of the physics step running from ROM, only compiled in with PHYSICS_IN_ROM=1.
+// Lets the cycle benchmark compare against the IWRAM build of the same code.
+
+#ifdef BLINX_PHYSICS_IN_ROM
+    #define BLINX_PHYSICS_ROM_COPY
+    #include "physics.bn_iwram.cpp"
+#endif
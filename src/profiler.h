@@ -0,0 +1,138 @@
+#pragma once
+
+// Opt-in frame profiler, built with `make PROFILE=1`.
+// Scoped timers count the CPU cycles each phase of the main loop takes, a small overlay shows CPU usage and
+// the worst frame, and every PROFILE_WINDOW frames the numbers go out through BN_LOG for the emulator's log.
+// Holding SELECT and pressing START opens Butano's profiler screen with the same phases.
+
+// Main loop phases timed by PROFILE_SCOPE
+enum profile_phase
+{
+    PROFILE_SIMULATION,
+    PROFILE_SPRITES,
+    PROFILE_CAMERA,
+    PROFILE_BACKGROUND,
+    PROFILE_PHASE_COUNT
+};
+
+#ifdef BLINX_PROFILE
+
+#include <bn_core.h>
+#include <bn_keypad.h>
+#include <bn_log.h>
+#include <bn_profiler.h>
+#include <bn_sprite_ptr.h>
+#include <bn_sprite_text_generator.h>
+#include <bn_string.h>
+#include <bn_vector.h>
+
+#include "common_variable_8x8_sprite_font.h"
+#include "cycle_timer.h"
+#include "layers.h"
+
+inline const char *const profile_phase_names[PROFILE_PHASE_COUNT] = {"sim", "sprites", "camera", "background"};
+
+// Frames averaged per overlay refresh and log line
+constexpr int PROFILE_WINDOW = 64;
+
+class frame_profiler
+{
+public:
+    static frame_profiler &instance()
+    {
+        static frame_profiler inst;
+        return inst;
+    }
+
+    void add(int phase, unsigned cycles)
+    {
+        _cycles[phase] += cycles;
+    }
+
+    // Call once per frame right after bn::core::update()
+    void end_frame()
+    {
+        if (bn::keypad::select_held() && bn::keypad::start_pressed())
+        {
+            bn::profiler::show();
+        }
+
+        int usage = (bn::core::last_cpu_usage() * 100).round_integer();
+        _usage_total += usage;
+        if (usage > _usage_worst)
+            _usage_worst = usage;
+
+        if (++_frames < PROFILE_WINDOW)
+            return;
+
+        int average = _usage_total / PROFILE_WINDOW;
+        BN_LOG("profile: cpu ", average, "% worst ", _usage_worst, "% cycles/frame sim ",
+               _cycles[PROFILE_SIMULATION] / PROFILE_WINDOW, " sprites ", _cycles[PROFILE_SPRITES] / PROFILE_WINDOW,
+               " camera ", _cycles[PROFILE_CAMERA] / PROFILE_WINDOW,
+               " background ", _cycles[PROFILE_BACKGROUND] / PROFILE_WINDOW);
+
+        bn::string<32> text = "CPU ";
+        text += bn::to_string<4>(average);
+        text += "% MAX ";
+        text += bn::to_string<4>(_usage_worst);
+        text += '%';
+        _text_sprites.clear();
+        _text_generator.generate(-116, -72, text, _text_sprites);
+
+        _frames = 0;
+        _usage_total = 0;
+        _usage_worst = 0;
+        for (unsigned &cycles : _cycles)
+            cycles = 0;
+    }
+
+private:
+    bn::sprite_text_generator _text_generator;
+    bn::vector<bn::sprite_ptr, 8> _text_sprites;
+    unsigned _cycles[PROFILE_PHASE_COUNT] = {};
+    int _frames = 0;
+    int _usage_total = 0;
+    int _usage_worst = 0;
+
+    frame_profiler()
+        : _text_generator(common::variable_8x8_sprite_font)
+    {
+        _text_generator.set_left_alignment();
+        _text_generator.set_bg_priority(OVERLAY_SPRITE_PRIORITY);
+        cycle_timer::run();
+    }
+};
+
+// Times the rest of the enclosing block as one phase, in both the frame profiler and Butano's profiler
+class profile_scope
+{
+public:
+    explicit profile_scope(int phase)
+        : _phase(phase), _start(cycle_timer::now())
+    {
+        BN_PROFILER_START(profile_phase_names[phase]);
+    }
+
+    ~profile_scope()
+    {
+        BN_PROFILER_STOP();
+        frame_profiler::instance().add(_phase, cycle_timer::now() - _start);
+    }
+
+    profile_scope(const profile_scope &) = delete;
+    profile_scope &operator=(const profile_scope &) = delete;
+
+private:
+    int _phase;
+    unsigned _start;
+};
+
+#define PROFILE_SCOPE(phase) profile_scope profile_scope_instance(phase)
+#define PROFILE_END_FRAME() frame_profiler::instance().end_frame()
+
+#else
+
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+
+#endif
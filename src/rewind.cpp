@@ -0,0 +1,159 @@
+#include <bn_assert.h>
+#include <bn_common.h>
+
+#include <cstring>
+
+#include "rewind.h"
+
+namespace
+{
+    // Worst case delta: every other byte changed, one skip and one count byte for each changed byte
+    constexpr int MAX_DELTA_SIZE = REWIND_STATE_SIZE + REWIND_STATE_SIZE / 2 + 4;
+
+    // Records carry their payload length at both ends, so the ring can be walked from either side
+    constexpr int RECORD_OVERHEAD = 4;
+
+    static_assert(MAX_DELTA_SIZE + RECORD_OVERHEAD <= REWIND_BUDGET, "A single frame has to fit in the rewind budget");
+
+    BN_DATA_EWRAM uint8_t ring[REWIND_BUDGET];
+    BN_DATA_EWRAM uint8_t present[REWIND_STATE_SIZE];
+    BN_DATA_EWRAM uint8_t next[REWIND_STATE_SIZE];
+    BN_DATA_EWRAM uint8_t delta[MAX_DELTA_SIZE];
+
+    void capture(const world &game, fixed camera_x, fixed camera_y, uint8_t *out)
+    {
+        game.save_state(out);
+        out += world::state_size();
+        std::memcpy(out, &camera_x, sizeof(fixed));
+        std::memcpy(out + sizeof(fixed), &camera_y, sizeof(fixed));
+    }
+
+    // Delta of two states as (unchanged count, changed count, changed bytes XORed) runs, trailing unchanged bytes
+    // are left out. Counts are capped at 255 and a zero changed count just continues the skip.
+    int encode(const uint8_t *from, const uint8_t *to, uint8_t *out)
+    {
+        int size = 0;
+        int last_change = REWIND_STATE_SIZE;
+        while (last_change > 0 && from[last_change - 1] == to[last_change - 1])
+            --last_change;
+
+        int i = 0;
+        while (i < last_change)
+        {
+            int skip = 0;
+            while (skip < 255 && i < last_change && from[i] == to[i])
+            {
+                ++skip;
+                ++i;
+            }
+
+            int count_index = size + 1;
+            out[size] = uint8_t(skip);
+            size += 2;
+
+            int count = 0;
+            while (count < 255 && i < last_change && from[i] != to[i])
+            {
+                out[size++] = from[i] ^ to[i];
+                ++count;
+                ++i;
+            }
+            out[count_index] = uint8_t(count);
+        }
+
+        return size;
+    }
+
+    // XORs a delta into a state, which turns either of the two states it was made from into the other
+    void apply(const uint8_t *data, int size, uint8_t *state)
+    {
+        int offset = 0;
+        for (int i = 0; i < size;)
+        {
+            offset += data[i];
+            int count = data[i + 1];
+            i += 2;
+
+            for (int end = i + count; i < end; ++i)
+            {
+                state[offset++] ^= data[i];
+            }
+        }
+    }
+}
+
+void rewind_buffer::reset(const world &game, fixed camera_x, fixed camera_y)
+{
+    capture(game, camera_x, camera_y, present);
+    _head = 0;
+    _used = 0;
+    _frames = 0;
+}
+
+void rewind_buffer::record(const world &game, fixed camera_x, fixed camera_y)
+{
+    capture(game, camera_x, camera_y, next);
+    int size = encode(present, next, delta);
+    std::memcpy(present, next, REWIND_STATE_SIZE);
+
+    while (_used + size + RECORD_OVERHEAD > REWIND_BUDGET)
+    {
+        _drop_oldest();
+    }
+
+    uint8_t length[2] = {uint8_t(size), uint8_t(size >> 8)};
+    int tail = _head + _used;
+    _write(tail, length, 2);
+    _write(tail + 2, delta, size);
+    _write(tail + 2 + size, length, 2);
+    _used += size + RECORD_OVERHEAD;
+    ++_frames;
+}
+
+bool rewind_buffer::step_back(world &game, fixed &camera_x, fixed &camera_y)
+{
+    if (_frames == 0)
+        return false;
+
+    uint8_t length[2];
+    int tail = _head + _used;
+    _read(tail - 2, length, 2);
+    int size = length[0] | (length[1] << 8);
+    _read(tail - 2 - size, delta, size);
+    _used -= size + RECORD_OVERHEAD;
+    --_frames;
+
+    apply(delta, size, present);
+    game.load_state(present);
+    std::memcpy(&camera_x, present + world::state_size(), sizeof(fixed));
+    std::memcpy(&camera_y, present + world::state_size() + sizeof(fixed), sizeof(fixed));
+    return true;
+}
+
+void rewind_buffer::_write(int offset, const uint8_t *data, int size)
+{
+    offset %= REWIND_BUDGET;
+    int first = REWIND_BUDGET - offset < size ? REWIND_BUDGET - offset : size;
+    std::memcpy(ring + offset, data, first);
+    std::memcpy(ring, data + first, size - first);
+}
+
+void rewind_buffer::_read(int offset, uint8_t *data, int size) const
+{
+    offset = ((offset % REWIND_BUDGET) + REWIND_BUDGET) % REWIND_BUDGET;
+    int first = REWIND_BUDGET - offset < size ? REWIND_BUDGET - offset : size;
+    std::memcpy(data, ring + offset, first);
+    std::memcpy(data + first, ring, size - first);
+}
+
+void rewind_buffer::_drop_oldest()
+{
+    BN_ASSERT(_frames > 0, "Rewind record larger than the budget");
+
+    uint8_t length[2];
+    _read(_head, length, 2);
+    int size = length[0] | (length[1] << 8);
+    _head = (_head + size + RECORD_OVERHEAD) % REWIND_BUDGET;
+    _used -= size + RECORD_OVERHEAD;
+    --_frames;
+}
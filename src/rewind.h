@@ -0,0 +1,39 @@
+#pragma once
+
+#include "entities.h"
+
+// Bytes of EWRAM kept for rewind history, several seconds of play at typical delta sizes
+constexpr int REWIND_BUDGET = 48 * 1024;
+
+// World state plus the camera, the unit the rewind buffer stores
+constexpr int REWIND_STATE_SIZE = world::state_size() + 2 * int(sizeof(fixed));
+
+// Ring buffer of past world states for rewinding time.
+// Each frame stores only the XOR of its state with the previous one, run-length coded, so the history costs a few
+// bytes per frame. Undoing a delta against the present state gives the frame before it, so stepping back is one
+// decode per frame no matter how far back the history goes. The oldest frames are dropped to stay in budget.
+// The buffers live in EWRAM and are shared, so only one rewind_buffer should be alive.
+class rewind_buffer
+{
+public:
+    // Forgets all history and takes the given state as the present
+    void reset(const world &game, fixed camera_x, fixed camera_y);
+
+    // Stores the step from the previous state to this one, call once per simulated frame
+    void record(const world &game, fixed camera_x, fixed camera_y);
+
+    // Restores the frame before the present one, returns false when there is no history left
+    bool step_back(world &game, fixed &camera_x, fixed &camera_y);
+
+    [[nodiscard]] int frames() const { return _frames; }
+    [[nodiscard]] int used_bytes() const { return _used; }
+
+private:
+    int _head = 0;   // ring offset of the oldest record
+    int _used = 0;   // ring bytes in use
+    int _frames = 0; // records in the ring
+
+    void _write(int offset, const uint8_t *data, int size);
+    void _read(int offset, uint8_t *data, int size) const;
+    void _drop_oldest();
+};
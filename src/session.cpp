@@ -0,0 +1,86 @@
+#include <bn_common.h>
+
+#include "session.h"
+
+namespace
+{
+    BN_DATA_EWRAM session_data recording;
+}
+
+int session_hash(const world &game)
+{
+    uint32_t hash = game.hash();
+    return int((hash ^ (hash >> 16)) & 0xffff);
+}
+
+int session_frames(const session_data &data)
+{
+    if (data.magic[0] != 'B' || data.magic[1] != 'S' || data.magic[2] != 'E' || data.magic[3] != 'S' ||
+        data.version != SESSION_FORMAT_VERSION)
+        return 0;
+
+    int frames = data.frame_count[0] | (data.frame_count[1] << 8);
+    return frames <= SESSION_MAX_FRAMES ? frames : 0;
+}
+
+void session_recorder::start(int level_index)
+{
+    recording.magic[0] = 'B';
+    recording.magic[1] = 'S';
+    recording.magic[2] = 'E';
+    recording.magic[3] = 'S';
+    recording.version = SESSION_FORMAT_VERSION;
+    recording.level_index = uint8_t(level_index);
+    recording.frame_count[0] = 0;
+    recording.frame_count[1] = 0;
+}
+
+void session_recorder::record(const world &game, int input)
+{
+    // A full session keeps its first SESSION_MAX_FRAMES frames
+    int frame = game.frame - 1;
+    if (frame >= SESSION_MAX_FRAMES)
+        return;
+
+    int hash = session_hash(game);
+    session_frame &entry = recording.frames[frame];
+    entry.input = uint8_t(input);
+    entry.hash[0] = uint8_t(hash);
+    entry.hash[1] = uint8_t(hash >> 8);
+    recording.frame_count[0] = uint8_t(game.frame);
+    recording.frame_count[1] = uint8_t(game.frame >> 8);
+}
+
+void session_recorder::rewound(const world &game)
+{
+    if (game.frame < session_frames(recording))
+    {
+        recording.frame_count[0] = uint8_t(game.frame);
+        recording.frame_count[1] = uint8_t(game.frame >> 8);
+    }
+}
+
+session_data &session_recorder::data()
+{
+    return recording;
+}
+
+session_replay::session_replay(const session_data &data)
+    : _data(data), _frame_count(session_frames(data))
+{
+}
+
+bool session_replay::step(world &game)
+{
+    if (_diverged || _frame == _frame_count)
+        return false;
+
+    const session_frame &entry = _data.frames[_frame];
+    game.update(entry.input);
+    ++_frame;
+
+    _expected = entry.hash[0] | (entry.hash[1] << 8);
+    _actual = session_hash(game);
+    _diverged = _expected != _actual;
+    return !_diverged;
+}
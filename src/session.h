@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+#include "entities.h"
+
+// Frames a session can hold, as many as fit in the 32 KB of cartridge SRAM, a bit over three minutes
+constexpr int SESSION_MAX_FRAMES = 10920;
+constexpr int SESSION_FORMAT_VERSION = 1;
+
+// One simulated frame: the input code it was stepped with and the world hash right after
+struct session_frame
+{
+    uint8_t input;
+    uint8_t hash[2]; // world::hash() folded to 16 bits, little endian
+};
+
+// A recorded play session from the start of one level, saved to SRAM as is and read back by host/replay.
+// Byte fields only, so the layout is the same in the ROM and on the host.
+struct session_data
+{
+    char magic[4];   // 'B' 'S' 'E' 'S'
+    uint8_t version;
+    uint8_t level_index;
+    uint8_t frame_count[2]; // little endian
+    session_frame frames[SESSION_MAX_FRAMES];
+};
+
+static_assert(sizeof(session_data) <= 32 * 1024, "Sessions are saved to SRAM");
+
+// World hash as stored in a session frame
+[[nodiscard]] int session_hash(const world &game);
+
+// Recorded frames, 0 if the data is not a session
+[[nodiscard]] int session_frames(const session_data &data);
+
+// Records every frame of play along with the world hash after it.
+// Frames are stored by world frame number, so after a rewind recording picks up from the restored frame, and
+// rewound() drops the frames that were undone.
+// The session buffer lives in EWRAM and is shared, so only one session_recorder should be alive.
+class session_recorder
+{
+public:
+    // Starts an empty session on a freshly created world
+    void start(int level_index);
+
+    // Stores the frame the world just stepped, call after world::update() with the input it was given
+    void record(const world &game, int input);
+
+    // Ends the session at the frame the world was just rewound to, call after stepping it back
+    void rewound(const world &game);
+
+    [[nodiscard]] session_data &data();
+};
+
+// Feeds a recorded session back into a world created on the same level, checking the hash of every frame.
+// Replay stops at the first frame whose hash differs from the recording.
+class session_replay
+{
+public:
+    explicit session_replay(const session_data &data);
+
+    // Steps the world one recorded frame, returns false once the session ended or the world diverged
+    bool step(world &game);
+
+    [[nodiscard]] bool diverged() const { return _diverged; }
+
+    // Frames replayed, the diverging one included
+    [[nodiscard]] int frames() const { return _frame; }
+
+    // Hashes of the last frame replayed
+    [[nodiscard]] int expected_hash() const { return _expected; }
+    [[nodiscard]] int actual_hash() const { return _actual; }
+
+private:
+    const session_data &_data;
+    int _frame_count;
+    int _frame = 0;
+    int _expected = 0;
+    int _actual = 0;
+    bool _diverged = false;
+};
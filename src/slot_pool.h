@@ -0,0 +1,204 @@
+#pragma once
+
+#include <bn_assert.h>
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Fixed-capacity pool with stable slot indices.
+// Live objects never move: spawning constructs in place in a free slot and retiring destroys in place,
+// so a slot index stays valid until that object is retired.
+// Live slots are also linked from oldest to newest, which makes evicting the oldest O(1).
+template<typename Type, int Capacity>
+class slot_pool
+{
+    static_assert(Capacity > 0 && Capacity < 128);
+
+public:
+    [[nodiscard]] static constexpr int capacity() { return Capacity; }
+
+    slot_pool()
+    {
+        // Free slots are handed out lowest index first
+        for (int slot = 0; slot < Capacity; ++slot)
+        {
+            _free[slot] = int8_t(Capacity - 1 - slot);
+            _alive[slot] = false;
+        }
+    }
+
+    slot_pool(const slot_pool &) = delete;
+    slot_pool &operator=(const slot_pool &) = delete;
+
+    ~slot_pool()
+    {
+        clear();
+    }
+
+    [[nodiscard]] int size() const { return _size; }
+    [[nodiscard]] bool empty() const { return _size == 0; }
+    [[nodiscard]] bool full() const { return _size == Capacity; }
+
+    [[nodiscard]] bool alive(int slot) const
+    {
+        return _alive[slot];
+    }
+
+    [[nodiscard]] Type &operator[](int slot)
+    {
+        BN_ASSERT(_alive[slot], "Slot is not alive: ", slot);
+        return *_object(slot);
+    }
+
+    [[nodiscard]] const Type &operator[](int slot) const
+    {
+        BN_ASSERT(_alive[slot], "Slot is not alive: ", slot);
+        return *_object(slot);
+    }
+
+    // Ends of the age order, -1 when the pool is empty
+    [[nodiscard]] int oldest() const { return _oldest; }
+    [[nodiscard]] int newest() const { return _newest; }
+
+    // Neighbours in age order, -1 past either end
+    [[nodiscard]] int older(int slot) const { return _older[slot]; }
+    [[nodiscard]] int newer(int slot) const { return _newer[slot]; }
+
+    // Constructs a new object in place, retiring the oldest one first when the pool is full
+    template<typename... Args>
+    int spawn(Args &&...args)
+    {
+        if (full())
+        {
+            retire(_oldest);
+        }
+
+        int slot = _free[--_free_count];
+        ::new (_object(slot)) Type(std::forward<Args>(args)...);
+        _alive[slot] = true;
+        ++_size;
+
+        _older[slot] = _newest;
+        _newer[slot] = -1;
+        if (_newest >= 0)
+        {
+            _newer[_newest] = int8_t(slot);
+        }
+        else
+        {
+            _oldest = int8_t(slot);
+        }
+        _newest = int8_t(slot);
+        return slot;
+    }
+
+    // Destroys an object in place, no other object moves
+    void retire(int slot)
+    {
+        BN_ASSERT(_alive[slot], "Slot is not alive: ", slot);
+
+        _object(slot)->~Type();
+        _alive[slot] = false;
+        --_size;
+        _free[_free_count++] = int8_t(slot);
+
+        int older_slot = _older[slot];
+        int newer_slot = _newer[slot];
+        if (older_slot >= 0)
+        {
+            _newer[older_slot] = int8_t(newer_slot);
+        }
+        else
+        {
+            _oldest = int8_t(newer_slot);
+        }
+        if (newer_slot >= 0)
+        {
+            _older[newer_slot] = int8_t(older_slot);
+        }
+        else
+        {
+            _newest = int8_t(older_slot);
+        }
+    }
+
+    // Size of the byte image save_state() writes
+    [[nodiscard]] static constexpr int state_size()
+    {
+        return int(sizeof(_storage) + sizeof(_older) + sizeof(_newer) + sizeof(_free) + sizeof(_alive)) + 4;
+    }
+
+    // Byte image of the whole pool, live objects included, so it can be restored later without running
+    // any constructor or destructor. Only for types that can be copied as bytes.
+    void save_state(uint8_t *out) const
+    {
+        static_assert(std::is_trivially_copyable_v<Type>, "Pool state is copied as bytes");
+
+        std::memcpy(out, _storage, sizeof(_storage));
+        out += sizeof(_storage);
+        std::memcpy(out, _older, sizeof(_older));
+        out += sizeof(_older);
+        std::memcpy(out, _newer, sizeof(_newer));
+        out += sizeof(_newer);
+        std::memcpy(out, _free, sizeof(_free));
+        out += sizeof(_free);
+        std::memcpy(out, _alive, sizeof(_alive));
+        out += sizeof(_alive);
+        out[0] = uint8_t(_oldest);
+        out[1] = uint8_t(_newest);
+        out[2] = uint8_t(_free_count);
+        out[3] = uint8_t(_size);
+    }
+
+    void load_state(const uint8_t *in)
+    {
+        static_assert(std::is_trivially_copyable_v<Type>, "Pool state is copied as bytes");
+
+        std::memcpy(_storage, in, sizeof(_storage));
+        in += sizeof(_storage);
+        std::memcpy(_older, in, sizeof(_older));
+        in += sizeof(_older);
+        std::memcpy(_newer, in, sizeof(_newer));
+        in += sizeof(_newer);
+        std::memcpy(_free, in, sizeof(_free));
+        in += sizeof(_free);
+        std::memcpy(_alive, in, sizeof(_alive));
+        in += sizeof(_alive);
+        _oldest = int8_t(in[0]);
+        _newest = int8_t(in[1]);
+        _free_count = int8_t(in[2]);
+        _size = int8_t(in[3]);
+    }
+
+    void clear()
+    {
+        while (_oldest >= 0)
+        {
+            retire(_oldest);
+        }
+    }
+
+private:
+    alignas(Type) uint8_t _storage[Capacity][sizeof(Type)];
+    int8_t _older[Capacity];
+    int8_t _newer[Capacity];
+    int8_t _free[Capacity];
+    bool _alive[Capacity];
+    int8_t _oldest = -1;
+    int8_t _newest = -1;
+    int8_t _free_count = Capacity;
+    int8_t _size = 0;
+
+    Type *_object(int slot)
+    {
+        return std::launder(reinterpret_cast<Type *>(_storage[slot]));
+    }
+
+    const Type *_object(int slot) const
+    {
+        return std::launder(reinterpret_cast<const Type *>(_storage[slot]));
+    }
+};
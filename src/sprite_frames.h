@@ -0,0 +1,49 @@
+#pragma once
+
+#include <bn_assert.h>
+#include <bn_optional.h>
+#include <bn_sprite_item.h>
+#include <bn_sprite_tiles_ptr.h>
+
+// VRAM tiles of each frame of a sprite sheet, shared by every sprite showing that frame.
+// A frame is uploaded when the first sprite switches to it and its tiles are freed once the last one moves on,
+// so VRAM use and copies follow how many different frames are on screen, not how many sprites.
+class sprite_frames
+{
+public:
+    static constexpr int MAX_FRAMES = 16;
+
+    explicit sprite_frames(const bn::sprite_item &item)
+        : _item(item)
+    {
+        BN_ASSERT(item.tiles_item().graphics_count() <= MAX_FRAMES, "Too many frames: ",
+                  item.tiles_item().graphics_count());
+    }
+
+    sprite_frames(const sprite_frames &) = delete;
+    sprite_frames &operator=(const sprite_frames &) = delete;
+
+    // Tiles of a frame for one more sprite, uploaded if no sprite showed it until now
+    const bn::sprite_tiles_ptr &acquire(int frame)
+    {
+        if (_users[frame]++ == 0)
+        {
+            _tiles[frame] = _item.tiles_item().create_new_tiles(frame);
+        }
+        return *_tiles[frame];
+    }
+
+    // One sprite fewer shows a frame, call once the sprite has moved to other tiles or been destroyed
+    void release(int frame)
+    {
+        if (--_users[frame] == 0)
+        {
+            _tiles[frame].reset();
+        }
+    }
+
+private:
+    const bn::sprite_item &_item;
+    bn::optional<bn::sprite_tiles_ptr> _tiles[MAX_FRAMES];
+    uint8_t _users[MAX_FRAMES] = {};
+};
@@ -1,4 +1,15 @@
 <?xml version="1.0" encoding="UTF-8"?>
 <tileset version="1.10" tiledversion="1.11.0" name="Demo" tilewidth="32" tileheight="32" tilecount="4" columns="1">
  <image source="../graphics/bg_tiles01.bmp" width="32" height="128"/>
+ <tile id="2">
+  <properties>
+   <property name="solid" type="bool" value="true"/>
+  </properties>
+ </tile>
+ <tile id="3">
+  <properties>
+   <property name="one_way" type="bool" value="true"/>
+   <property name="solid" type="bool" value="false"/>
+  </properties>
+ </tile>
 </tileset>